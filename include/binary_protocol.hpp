@@ -0,0 +1,435 @@
+#ifndef BINARY_PROTOCOL_HPP
+#define BINARY_PROTOCOL_HPP
+
+#include <Arduino.h>
+
+#include "configuration.hpp"
+#include "profiler.hpp"
+
+/**
+ * @file binary_protocol.hpp
+ * @brief Message layouts and framing helpers of the binary serial protocol.
+ *
+ * @details A frame is made of a message id, a fixed-layout payload and a CRC-16
+ * (CCITT-FALSE, little-endian) of the id and payload. The whole frame is COBS
+ * encoded and terminated by a 0x00 delimiter. All fields are little-endian and
+ * floats are IEEE-754 single precision, which matches both AVR and x86 hosts.
+ */
+
+/**
+ * @brief Largest payload of a frame. Frames are COBS encoded in place, which needs
+ * the raw frame (id, payload and CRC-16) to be shorter than 254 bytes, see
+ * cobs_encode_in_place(). Payloads sized by the configuration are checked against
+ * it at build time.
+ */
+#define BINARY_MAX_PAYLOAD_SIZE 250
+
+/**
+ * @enum MessageId
+ * @brief Identifiers of the binary messages. Ids with the high bit set are sent
+ * by the motor controller.
+ */
+typedef enum : uint8_t {
+    MSG_CMD_VEL = 0x01,              /**< CmdVelMsg: closed-loop velocity command */
+    MSG_OPEN_LOOP = 0x02,            /**< OpenLoopMsg: open-loop PWM command */
+    MSG_POSE_GET = 0x03,             /**< No payload: request robot's pose */
+    MSG_MOTOR_STATUS_GET = 0x04,     /**< No payload: request motor status */
+    MSG_RESET_POSE = 0x05,           /**< No payload: reset the robot's pose */
+    MSG_PID_SET = 0x06,              /**< PidGainsMsg: update PID gains */
+    MSG_PID_GET = 0x07,              /**< No payload: request PID gains */
+    MSG_TEXT_MODE = 0x08,            /**< No payload: switch to the text protocol */
+    MSG_TELEMETRY_SET = 0x09,        /**< TelemetryRateMsg: stream telemetry */
+    MSG_FEEDFORWARD_SET = 0x0A,      /**< FeedForwardMsg: update feed-forward gains */
+    MSG_FEEDFORWARD_GET = 0x0B,      /**< No payload: request feed-forward gains */
+    MSG_AUTOTUNE_START = 0x0C,       /**< AutotuneStartMsg: start the PID auto-tuner */
+    MSG_AUTOTUNE_GET = 0x0D,         /**< No payload: request the auto-tuner status */
+    MSG_GAIN_BREAKPOINT_SET = 0x0E,  /**< GainBreakpointMsg: set a gain breakpoint */
+    MSG_GAIN_SCHEDULE_GET = 0x0F,    /**< WheelMsg: request a gain schedule */
+    MSG_GEOMETRY_SET = 0x10,         /**< GeometryMsg: set the robot's dimensions */
+    MSG_GEOMETRY_GET = 0x11,         /**< No payload: request the robot's dimensions */
+    MSG_PARAMS_SAVE = 0x12,          /**< No payload: save the parameters in EEPROM */
+    MSG_TASK_STATS_GET = 0x13,       /**< No payload: request the task statistics */
+    MSG_PROFILE_GET = 0x14,          /**< No payload: request the profile (PROFILING) */
+    MSG_RECORDER_START = 0x15,       /**< RecorderStartMsg: start recording samples */
+    MSG_RECORDER_GET = 0x16,         /**< RecorderGetMsg: request recorded samples */
+    MSG_CMD_VEL_REPORT = 0x17,       /**< CmdVelMsg: cmd_vel, returning the state */
+    MSG_MOVE = 0x18,                 /**< MoveMsg: start a position move */
+    MSG_ACK = 0x80,                  /**< AckMsg: acknowledgment of a command */
+    MSG_POSE = 0x81,                 /**< PoseMsg: robot's pose */
+    MSG_MOTOR_STATUS = 0x82,         /**< MotorStatusMsg: status of the motors */
+    MSG_PID_GAINS = 0x83,            /**< PidGainsMsg: current PID gains */
+    MSG_TELEMETRY = 0x84,            /**< TelemetryMsg: streamed telemetry sample */
+    MSG_FEEDFORWARD_GAINS = 0x85,    /**< FeedForwardMsg: current feed-forward gains */
+    MSG_AUTOTUNE_STATUS = 0x86,      /**< AutotuneStatusMsg: auto-tuner status */
+    MSG_GAIN_SCHEDULE = 0x87,        /**< GainScheduleMsg: gain schedule of a wheel */
+    MSG_GEOMETRY = 0x88,             /**< GeometryMsg: robot's dimensions */
+    MSG_PARAMS_SAVED = 0x89,         /**< ParamsSavedMsg: parameters saved */
+    MSG_TASK_STATS = 0x8A,           /**< TaskStatsMsg: statistics of the tasks */
+    MSG_PROFILE = 0x8B,              /**< ProfileMsg: profile of the firmware stages */
+    MSG_RECORDER_DATA = 0x8C,        /**< RecorderDataMsg: recorded samples */
+    MSG_STATE = 0x8D,                /**< StateMsg: state after MSG_CMD_VEL_REPORT */
+    MSG_MOVE_DONE = 0x8E             /**< MoveDoneMsg: a position move has ended */
+} MessageId;
+
+/**
+ * @struct CmdVelMsg
+ * @brief Payload of MSG_CMD_VEL.
+ */
+typedef struct __attribute__((packed)) {
+    float x;  ///< Linear velocity (in m/s).
+    float w;  ///< Angular velocity (in rad/s).
+} CmdVelMsg;
+
+/**
+ * @struct OpenLoopMsg
+ * @brief Payload of MSG_OPEN_LOOP.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t left_pwm;   ///< PWM value of the left motor.
+    uint8_t right_pwm;  ///< PWM value of the right motor.
+} OpenLoopMsg;
+
+/**
+ * @struct PoseMsg
+ * @brief Payload of MSG_POSE.
+ */
+typedef struct __attribute__((packed)) {
+    float x;      ///< The x-coordinate of the robot's position (in m).
+    float y;      ///< The y-coordinate of the robot's position (in m).
+    float theta;  ///< The orientation of the robot (in radians).
+} PoseMsg;
+
+/**
+ * @struct MotorDataMsg
+ * @brief Wire layout of MotorData.
+ */
+typedef struct __attribute__((packed)) {
+    float rpm;               ///< Revolutions per minute.
+    float velocity;          ///< Linear velocity (in m/s).
+    float angular_velocity;  ///< Angular velocity (in rad/s).
+    float distance;          ///< Total travelled distance (in m).
+    float angle;             ///< Angular position (in radians).
+} MotorDataMsg;
+
+/**
+ * @struct MotorStatusMsg
+ * @brief Payload of MSG_MOTOR_STATUS.
+ */
+typedef struct __attribute__((packed)) {
+    MotorDataMsg wheels[MAX_WHEELS];  ///< Status of each wheel, zero if unused.
+} MotorStatusMsg;
+static_assert(sizeof(MotorStatusMsg) <= BINARY_MAX_PAYLOAD_SIZE,
+              "MotorStatusMsg too large for a frame, lower MAX_WHEELS");
+
+/**
+ * @struct PidGainsMsg
+ * @brief Payload of MSG_PID_SET and MSG_PID_GAINS.
+ */
+typedef struct __attribute__((packed)) {
+    float kp;  ///< Proportional gain.
+    float ki;  ///< Integral gain.
+    float kd;  ///< Derivative gain.
+} PidGainsMsg;
+
+/**
+ * @struct FeedForwardMsg
+ * @brief Payload of MSG_FEEDFORWARD_SET and MSG_FEEDFORWARD_GAINS.
+ */
+typedef struct __attribute__((packed)) {
+    float ks;  ///< Static friction (PWM).
+    float kv;  ///< Velocity gain (PWM per m/s).
+    float ka;  ///< Acceleration gain (PWM per m/s^2).
+} FeedForwardMsg;
+
+/**
+ * @struct AutotuneStartMsg
+ * @brief Payload of MSG_AUTOTUNE_START.
+ */
+typedef struct __attribute__((packed)) {
+    float setpoint;     ///< Wheel velocity to oscillate around (in m/s).
+    uint8_t amplitude;  ///< Relay amplitude (in PWM).
+    uint8_t rule;       ///< TuningRule used to compute the gains.
+} AutotuneStartMsg;
+
+/**
+ * @struct AutotuneResultMsg
+ * @brief Result of the auto-tuning experiment of a wheel.
+ */
+typedef struct __attribute__((packed)) {
+    float ku;  ///< Ultimate gain (in PWM per m/s).
+    float pu;  ///< Ultimate period (in s).
+} AutotuneResultMsg;
+
+/**
+ * @struct AutotuneStatusMsg
+ * @brief Payload of MSG_AUTOTUNE_STATUS.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t state;                         ///< 0 idle, 1 running, 2 done, 3 failed.
+    AutotuneResultMsg wheels[MAX_WHEELS];  ///< Result of each wheel, zero if unused.
+} AutotuneStatusMsg;
+static_assert(sizeof(AutotuneStatusMsg) <= BINARY_MAX_PAYLOAD_SIZE,
+              "AutotuneStatusMsg too large for a frame, lower MAX_WHEELS");
+
+/**
+ * @struct WheelMsg
+ * @brief Payload of the requests addressed to one wheel.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t wheel;  ///< Index of the wheel (0 left, 1 right on a 2 wheel robot).
+} WheelMsg;
+
+/**
+ * @struct GainBreakpointMsg
+ * @brief Payload of MSG_GAIN_BREAKPOINT_SET.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t wheel;      ///< Index of the wheel, see WheelMsg.
+    uint8_t index;      ///< Index of the breakpoint in the schedule.
+    float velocity;     ///< Magnitude of the velocity setpoint (in m/s).
+    PidGainsMsg gains;  ///< PID gains at this velocity.
+} GainBreakpointMsg;
+
+/**
+ * @struct GainScheduleMsg
+ * @brief Payload of MSG_GAIN_SCHEDULE. Breakpoints beyond count are zeroed.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t wheel;  ///< Index of the wheel, see WheelMsg.
+    uint8_t count;  ///< Number of breakpoints.
+    struct __attribute__((packed)) {
+        float velocity;     ///< Magnitude of the velocity setpoint (in m/s).
+        PidGainsMsg gains;  ///< PID gains at this velocity.
+    } breakpoints[PID_GAIN_SCHEDULE_SIZE];  ///< Breakpoints by increasing velocity.
+} GainScheduleMsg;
+static_assert(sizeof(GainScheduleMsg) <= BINARY_MAX_PAYLOAD_SIZE,
+              "GainScheduleMsg too large for a frame, lower PID_GAIN_SCHEDULE_SIZE");
+
+/**
+ * @struct GeometryMsg
+ * @brief Payload of MSG_GEOMETRY_SET and MSG_GEOMETRY.
+ */
+typedef struct __attribute__((packed)) {
+    float wheel_radius;         ///< Radius of the wheels (in m).
+    float dist_between_wheels;  ///< Distance between the wheels (in m).
+    uint16_t ticks_per_rev;     ///< Encoder ticks per wheel revolution (1x).
+} GeometryMsg;
+
+/**
+ * @struct ParamsSavedMsg
+ * @brief Payload of MSG_PARAMS_SAVED.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t bytes_written;  ///< Number of EEPROM bytes that changed.
+} ParamsSavedMsg;
+
+/**
+ * @struct TelemetryRateMsg
+ * @brief Payload of MSG_TELEMETRY_SET.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t rate;  ///< Sampling rate (in Hz), 0 to stop streaming.
+} TelemetryRateMsg;
+
+/**
+ * @struct TelemetryMsg
+ * @brief Payload of MSG_TELEMETRY.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t seq;           ///< Sequence number, restarts at 0 on subscription.
+    uint32_t timestamp;     ///< Time of the control tick (in milliseconds).
+    PoseMsg pose;           ///< Robot's pose.
+    MotorStatusMsg motors;  ///< Status of the motors.
+} TelemetryMsg;
+static_assert(sizeof(TelemetryMsg) <= BINARY_MAX_PAYLOAD_SIZE,
+              "TelemetryMsg too large for a frame, lower MAX_WHEELS");
+
+/**
+ * @struct StateMsg
+ * @brief Payload of MSG_STATE.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp;     ///< Time of the last control tick (in milliseconds).
+    PoseMsg pose;           ///< Robot's pose.
+    MotorStatusMsg motors;  ///< Status of the motors.
+} StateMsg;
+static_assert(sizeof(StateMsg) <= BINARY_MAX_PAYLOAD_SIZE,
+              "StateMsg too large for a frame, lower MAX_WHEELS");
+
+/**
+ * @struct MoveMsg
+ * @brief Payload of MSG_MOVE.
+ */
+typedef struct __attribute__((packed)) {
+    float distance;  ///< Distance to travel (in m, negative backwards).
+    float angle;     ///< Angle to turn (in rad, positive counterclockwise).
+} MoveMsg;
+
+/**
+ * @struct MoveDoneMsg
+ * @brief Payload of MSG_MOVE_DONE.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t state;   ///< 2 reached, 3 timed out, 4 cancelled (MoveState).
+    float distance;  ///< Distance travelled (in m).
+    float angle;     ///< Angle turned (in rad).
+} MoveDoneMsg;
+
+/**
+ * @struct TaskStatsMsg
+ * @brief Payload of MSG_TASK_STATS. Tasks beyond count are zeroed.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t count;  ///< Number of tasks.
+    struct __attribute__((packed)) {
+        uint32_t runs;             ///< Number of runs.
+        uint16_t overruns;         ///< Releases skipped.
+        uint16_t deadline_misses;  ///< Runs completed after the next release.
+        uint16_t max_duration;     ///< Longest run (in us).
+    } tasks[SCHEDULER_MAX_TASKS];  ///< Statistics of each task, by priority.
+} TaskStatsMsg;
+static_assert(sizeof(TaskStatsMsg) <= BINARY_MAX_PAYLOAD_SIZE,
+              "TaskStatsMsg too large for a frame, lower SCHEDULER_MAX_TASKS");
+
+/**
+ * @struct ProfileMsg
+ * @brief Payload of MSG_PROFILE, counters since the last request (in us).
+ */
+typedef struct __attribute__((packed)) {
+    struct __attribute__((packed)) {
+        uint16_t min_duration;   ///< Shortest run.
+        uint16_t max_duration;   ///< Longest run.
+        uint16_t mean_duration;  ///< Mean run.
+        uint16_t count;          ///< Number of runs measured.
+    } stages[PROFILE_STAGE_COUNT];                     ///< By ProfileStage.
+    uint16_t loop_histogram[PROFILER_HISTOGRAM_BINS];  ///< Main loop periods.
+} ProfileMsg;
+static_assert(sizeof(ProfileMsg) <= BINARY_MAX_PAYLOAD_SIZE,
+              "ProfileMsg too large for a frame, lower PROFILER_HISTOGRAM_BINS");
+
+/**
+ * @brief Number of records sent in a MSG_RECORDER_DATA message.
+ */
+#define BINARY_RECORDER_CHUNK_SIZE 4
+
+/**
+ * @struct RecorderStartMsg
+ * @brief Payload of MSG_RECORDER_START.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t trigger;  ///< 0 now, 1 on the next setpoint change.
+    uint8_t divider;  ///< Control ticks per record.
+} RecorderStartMsg;
+
+/**
+ * @struct RecorderGetMsg
+ * @brief Payload of MSG_RECORDER_GET.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t index;  ///< Index of the first record requested.
+} RecorderGetMsg;
+
+/**
+ * @struct RecorderDataMsg
+ * @brief Payload of MSG_RECORDER_DATA. Records beyond count are zeroed.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t state;          ///< RecorderState.
+    uint8_t count;          ///< Number of records in the recorder.
+    uint8_t trigger_index;  ///< Index of the first record after the trigger.
+    uint8_t divider;        ///< Control ticks per record.
+    uint8_t index;          ///< Index of the first record of the message.
+    struct __attribute__((packed)) {
+        int16_t setpoint;  ///< Velocity setpoint (in mm/s).
+        int16_t velocity;  ///< Measured velocity (in mm/s).
+        int16_t pwm;       ///< PWM applied, negative when reversing.
+        int8_t ticks;      ///< Encoder counts since the previous tick.
+    } records[BINARY_RECORDER_CHUNK_SIZE][MAX_WHEELS];  ///< Records, by wheel.
+} RecorderDataMsg;
+static_assert(sizeof(RecorderDataMsg) <= BINARY_MAX_PAYLOAD_SIZE,
+              "RecorderDataMsg too large for a frame, lower MAX_WHEELS or "
+              "BINARY_RECORDER_CHUNK_SIZE");
+
+/**
+ * @struct AckMsg
+ * @brief Payload of MSG_ACK. The code is the same as the one of the text
+ * protocol acknowledgments (0 for success, negative for errors).
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t id;   ///< Id of the acknowledged message.
+    int8_t code;  ///< Status code.
+} AckMsg;
+
+/**
+ * @brief Size of the frame overhead: message id and CRC-16.
+ */
+#define BINARY_FRAME_OVERHEAD 3
+static_assert(BINARY_MAX_PAYLOAD_SIZE + BINARY_FRAME_OVERHEAD < 254,
+              "frames too long to be COBS encoded in place");
+
+/**
+ * @brief Largest payload received by the motor controller.
+ */
+#define BINARY_MAX_RX_PAYLOAD_SIZE sizeof(GainBreakpointMsg)
+
+/**
+ * @brief Larger of two payload sizes.
+ */
+#define BINARY_MAX_SIZE(a, b) ((a) > (b) ? (a) : (b))
+
+/**
+ * @brief Size of the profile payload, only sent with PROFILING.
+ */
+#if PROFILING
+#define BINARY_PROFILE_PAYLOAD_SIZE sizeof(ProfileMsg)
+#else
+#define BINARY_PROFILE_PAYLOAD_SIZE 0
+#endif
+
+/**
+ * @brief Largest payload sent by the motor controller.
+ */
+#define BINARY_MAX_TX_PAYLOAD_SIZE                                          \
+    BINARY_MAX_SIZE(                                                        \
+        BINARY_MAX_SIZE(sizeof(TelemetryMsg), sizeof(GainScheduleMsg)),     \
+        BINARY_MAX_SIZE(                                                    \
+            BINARY_MAX_SIZE(sizeof(TaskStatsMsg), sizeof(RecorderDataMsg)), \
+            BINARY_PROFILE_PAYLOAD_SIZE))
+static_assert(BINARY_MAX_TX_PAYLOAD_SIZE <= BINARY_MAX_PAYLOAD_SIZE,
+              "payloads sent too large for a frame");
+static_assert(BINARY_MAX_RX_PAYLOAD_SIZE <= BINARY_MAX_PAYLOAD_SIZE,
+              "payloads received too large for a frame");
+
+/**
+ * @brief Size of a buffer holding an encoded frame (COBS adds one byte).
+ */
+#define BINARY_FRAME_BUFFER_SIZE(payload_size) \
+    ((payload_size) + BINARY_FRAME_OVERHEAD + 1)
+
+/**
+ * @brief Compute the CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) of a buffer.
+ * @param data The bytes to checksum.
+ * @param len The number of bytes.
+ * @param crc The CRC-16 of the preceding bytes, to checksum data in several parts.
+ * @return The CRC-16.
+ */
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF);
+
+/**
+ * @brief COBS encode a buffer in place.
+ * @param buffer Buffer holding the raw frame starting at index 1. On return, it
+ * holds the encoded frame starting at index 0, without the trailing delimiter.
+ * @param len The length of the raw frame. Must be lower than 254.
+ * @return The length of the encoded frame (len + 1).
+ */
+size_t cobs_encode_in_place(uint8_t *buffer, size_t len);
+
+/**
+ * @brief COBS decode a buffer in place.
+ * @param buffer The encoded frame, without the trailing delimiter.
+ * @param len The length of the encoded frame.
+ * @return The length of the decoded frame, or 0 if the encoding is invalid.
+ */
+size_t cobs_decode_in_place(uint8_t *buffer, size_t len);
+
+#endif  // !BINARY_PROTOCOL_HPP
@@ -7,9 +7,15 @@
 // ---------------------------| Motor GPIO Pins |-------------------------------
 // -----------------------------------------------------------------------------
 
-// GPIO pin configuration for the right motor.
+// GPIO pin configuration for the right motor. With CONTROL_LOOP_TIMER_ISR, Timer1
+// drives the PWM of pin 10, so the enable and IN1 pins are swapped.
+#if CONTROL_LOOP_TIMER_ISR
+#define GPIO_MOTOR_RIGHT_EN 6  // Must be a PWM pin
+#define GPIO_MOTOR_RIGHT_IN1 10
+#else
 #define GPIO_MOTOR_RIGHT_EN 10  // Must be a PWM pin
 #define GPIO_MOTOR_RIGHT_IN1 6
+#endif
 #define GPIO_MOTOR_RIGHT_IN2 7
 #define GPIO_MOTOR_RIGHT_ENCODER_A 3  // Must be a hardware interrupt pin
 #define GPIO_MOTOR_RIGHT_ENCODER_B 5
@@ -27,18 +33,130 @@
 
 // Motor and encoder configuration settings.
 #define WHEEL_RADIUS 0.0339  // Wheel radius in meters
-#define ENCODER_TICKS_PER_REVOLUTION 490
+#define ENCODER_TICKS_PER_REVOLUTION 490  // Rising edges of phase A per revolution
+
+// Count every edge of both encoder phases (4x the resolution) with pin change
+// interrupts, instead of the rising edges of phase A only.
+#ifndef ENCODER_QUADRATURE_4X
+#define ENCODER_QUADRATURE_4X 0
+#endif
+
+// Encoder counts per tick seen by the motor drivers.
+#if ENCODER_QUADRATURE_4X
+#define ENCODER_COUNTS_PER_TICK 4
+#else
+#define ENCODER_COUNTS_PER_TICK 1
+#endif
 #define DIST_BETWEEN_WHEELS 0.20  // Distance between wheels in meters
 
+// Maximum number of driven wheels, sizing the per-wheel state of the controller,
+// the saved parameters and the binary protocol messages. The wheels actually used
+// are given to the MotorController constructor, see main.cpp.
+#ifndef MAX_WHEELS
+#define MAX_WHEELS 2
+#endif
+
+// Kinematics model: KINEMATICS_DIFF_DRIVE, or KINEMATICS_SKID_STEER for platforms
+// whose wheels slip sideways when turning (4WD). The slip factor (>= 1) is the
+// ratio of the effective to the measured distance between the wheels, measured by
+// turning in place: wheel travel difference / (turned angle * distance).
+#define KINEMATICS_MODEL KINEMATICS_DIFF_DRIVE
+#define SKID_STEER_SLIP_FACTOR 1.5
+
 // PID gains
 #define MOTOR_DRIVER_PID_KP 200.0
 #define MOTOR_DRIVER_PID_KI 70.0
 #define MOTOR_DRIVER_PID_KD 30.0
 
-#define MOTOR_RUN_FREQUENCY 20  // Motor run frequency (in Hz)
+// Maximum number of breakpoints of the gain schedule of each wheel. The PID gains
+// are interpolated between breakpoints by the magnitude of the velocity setpoint.
+#define PID_GAIN_SCHEDULE_SIZE 4
+
+// Feed-forward added to the PID output: static friction / deadband (PWM), velocity
+// gain (PWM per m/s) and acceleration gain (PWM per m/s^2). Estimate them with
+// scripts/fit_feedforward.py.
+#define MOTOR_DRIVER_FF_KS 0.0
+#define MOTOR_DRIVER_FF_KV 0.0
+#define MOTOR_DRIVER_FF_KA 0.0
+
+// Rates of the tasks run by the scheduler (task_scheduler.hpp): the velocity loop
+// (encoders and PID), the odometry, and the telemetry stream (its highest rate).
+#define MOTOR_RUN_FREQUENCY 100  // Velocity loop frequency (in Hz)
+#define ODOMETRY_FREQUENCY 20    // Odometry frequency (in Hz)
+#define TELEMETRY_FREQUENCY 20   // Telemetry task frequency (in Hz)
+#define SCHEDULER_MAX_TASKS 4    // Maximum number of scheduled tasks
+
+// Measure the execution time of the velocity loop, motor data, PIDs, odometry and
+// serial input, and histogram the main loop periods, see profiler.hpp and the `x`
+// command. Each measured run costs two micros() calls.
+#ifndef PROFILING
+#define PROFILING 0
+#endif
+#define PROFILER_HISTOGRAM_BINS 10  // Power-of-two loop period bins, from 16 us
+
+// Sample recorder (sample_recorder.hpp): number of control ticks recorded, 7
+// bytes of RAM per wheel each, and how many of them precede the trigger when
+// recording is triggered by a setpoint change.
+#define RECORDER_SIZE 24
+#define RECORDER_PRETRIGGER 4
+
+// Velocity estimation: with fewer encoder ticks than this per control period, the
+// tick rate is measured between edge timestamps instead of counted over the
+// period (at most 134). Without edge for VELOCITY_TIMEOUT_MS, the velocity is 0.
+#define VELOCITY_PERIOD_THRESHOLD_TICKS 8
+#define VELOCITY_TIMEOUT_MS 250
+
+// Run the control loop from a Timer1 interrupt instead of polling millis() in
+// loop(), so that serial traffic does not delay it. Timer1 drives the PWM of pins
+// 9 and 10, which must not be used as motor enable pins in this mode (see the
+// right motor pins above).
+#ifndef CONTROL_LOOP_TIMER_ISR
+#define CONTROL_LOOP_TIMER_ISR 0
+#endif
 
 #define MOTOR_MAX_VELOCITY 1.0  // Maximum velocity in m/s
 
+// Relay auto-tuner: hysteresis of the relay around the velocity setpoint (in m/s),
+// number of oscillation cycles averaged, and time after which the experiment is
+// abandoned.
+#define AUTOTUNE_NOISE_BAND 0.02
+#define AUTOTUNE_CYCLES 4
+#define AUTOTUNE_TIMEOUT_MS 15000
+
+// Limits of the velocity profile ramping cmd_vel on every control tick, 0 to
+// disable a limit. Linear in m/s^2 and m/s^3, angular in rad/s^2 and rad/s^3.
+#define CMD_VEL_MAX_LINEAR_ACCELERATION 1.0
+#define CMD_VEL_MAX_LINEAR_JERK 10.0
+#define CMD_VEL_MAX_ANGULAR_ACCELERATION 6.0
+#define CMD_VEL_MAX_ANGULAR_JERK 60.0
+
+// Position moves (`t` command): limits of the trapezoidal profiles of the distance
+// (in m/s and m/s^2) and of the angle (in rad/s and rad/s^2), gains of the outer
+// loop adding the position error to the profiled velocity (in 1/s), tolerances on
+// the final error (in m and rad), and time allowed to settle within them once the
+// profiles have ended.
+#define POSITION_MAX_LINEAR_VELOCITY 0.3
+#define POSITION_MAX_LINEAR_ACCELERATION 0.5
+#define POSITION_MAX_ANGULAR_VELOCITY 2.0
+#define POSITION_MAX_ANGULAR_ACCELERATION 4.0
+#define POSITION_KP_LINEAR 4.0
+#define POSITION_KP_ANGULAR 4.0
+#define POSITION_TOLERANCE_LINEAR 0.005
+#define POSITION_TOLERANCE_ANGULAR 0.02
+#define POSITION_SETTLE_TIMEOUT_MS 1000
+
+// Compute wheel velocities and odometry with 32-bit fixed-point arithmetic instead
+// of software-emulated float. Recommended on boards without an FPU (ATmega328).
+#ifndef FIXED_POINT_ODOMETRY
+#define FIXED_POINT_ODOMETRY 0
+#endif
+
+// Use an interpolated lookup table (max error 1.4e-4) instead of libm for the sine
+// and cosine of the float odometry. Not used by FIXED_POINT_ODOMETRY.
+#ifndef ODOMETRY_TRIG_TABLE
+#define ODOMETRY_TRIG_TABLE 1
+#endif
+
 // -----------------------------------------------------------------------------
 // ----------------------------| Serial Configuration |-------------------------
 // -----------------------------------------------------------------------------
@@ -47,4 +165,49 @@
 // the baud rate in platformio.ini
 #define SERIAL_BAUD_RATE 9600
 
+// EEPROM address of the saved parameters (about 180 bytes), see
+// parameter_store.hpp.
+#define PARAMETER_STORE_ADDRESS 0
+
+// Maximum length of a text command, including the null terminator. Longer lines
+// are dropped and acknowledged with an error.
+#define SERIAL_LINE_BUFFER_SIZE 40
+
+// Longest telemetry sample, up to 40 characters per wheel.
+#define SERIAL_TELEMETRY_SIZE (48 + 40 * MAX_WHEELS)
+
+// Longest profile reply with PROFILING: 4 counters of up to 5 digits for each of
+// the 6 stages, then the loop period histogram.
+#if PROFILING
+#define SERIAL_PROFILE_REPLY_SIZE (24 * 6 + 6 * PROFILER_HISTOGRAM_BINS + 2)
+#else
+#define SERIAL_PROFILE_REPLY_SIZE 0
+#endif
+
+// Longest serial reply: a telemetry sample, a profile or a binary frame. Commands
+// are processed only while this much of the reply buffer is free, and telemetry
+// always leaves it free, so that commands never wait for it.
+#define SERIAL_MAX_REPLY_SIZE                                                      \
+    (SERIAL_PROFILE_REPLY_SIZE > SERIAL_TELEMETRY_SIZE ? SERIAL_PROFILE_REPLY_SIZE \
+                                                       : SERIAL_TELEMETRY_SIZE)
+
+// Size of the buffer holding the serial replies until the UART accepts them, so
+// that writing never blocks the main loop: a telemetry sample and the longest reply.
+// Replies that do not fit are answered with an error.
+#define SERIAL_REPLY_BUFFER_SIZE (SERIAL_TELEMETRY_SIZE + SERIAL_MAX_REPLY_SIZE)
+
+// Apply only the newest of consecutive velocity and open-loop commands read in a
+// main loop pass, so that a backlog of stale setpoints is skipped. The skipped
+// ones are counted, see the `e` command.
+#ifndef SERIAL_COALESCE_SETPOINTS
+#define SERIAL_COALESCE_SETPOINTS 0
+#endif
+
+// Acknowledge the valid velocity and open-loop commands. Without it they are fire
+// and forget: only their errors are acknowledged, which also lets a backlog be
+// coalesced in a single pass.
+#ifndef SERIAL_ACK_SETPOINTS
+#define SERIAL_ACK_SETPOINTS 1
+#endif
+
 #endif  // !CONFIGURATION_HPP
@@ -0,0 +1,33 @@
+#ifndef CONTROL_TIMER_HPP
+#define CONTROL_TIMER_HPP
+
+#include <Arduino.h>
+
+/**
+ * @class ControlTimer
+ * @brief Periodic hardware timer interrupt running the control loop
+ * (CONTROL_LOOP_TIMER_ISR).
+ *
+ * @details On AVR, Timer1 is used in CTC mode with a /64 prescaler, which supports
+ * frequencies from 4Hz up. Timer1 also generates the PWM of pins 9 and 10, which
+ * can therefore not be used as motor enable pins (the right motor pins are swapped
+ * in this mode, see configuration.hpp). The callback runs with interrupts enabled,
+ * so encoder edges are not missed during a control step, and the timer interrupt
+ * itself is masked until the callback returns.
+ */
+class ControlTimer {
+   public:
+    /**
+     * @brief Start calling a function at a fixed frequency from the timer interrupt.
+     * @param frequency The frequency (in Hz).
+     * @param callback The function to call.
+     */
+    static void begin(uint16_t frequency, void (*callback)(void));
+
+    /**
+     * @brief Stop the timer interrupt.
+     */
+    static void end(void);
+};
+
+#endif  // !CONTROL_TIMER_HPP
@@ -3,6 +3,15 @@
 
 #include <Arduino.h>
 
+/**
+ * @struct EncoderSample
+ * @brief Tick count of an encoder and time of its last counted edge, read together.
+ */
+typedef struct {
+    int32_t ticks;            ///< Tick count.
+    unsigned long edge_time;  ///< Time of the last counted edge (in us, micros()).
+} EncoderSample;
+
 /**
  * @class Encoder
  * @brief A class to interface with an encoder using two input pins.
@@ -19,7 +28,8 @@ class Encoder {
     Encoder(uint8_t pin_a, uint8_t pin_b, bool reverse = false);
 
     /**
-     * @brief Reset the encoder's tick count to zero.
+     * @brief Reset the encoder's tick count to zero and sample the current state of
+     * the pins for quadrature_isr().
      */
     void reset(void);
 
@@ -35,6 +45,39 @@ class Encoder {
      */
     void tick_isr(void);
 
+    /**
+     * @brief Interrupt service routine (ISR) for 4x quadrature decoding.
+     * @details This ISR should be called on every edge of both encoder pins. It
+     * counts one tick per edge, and counts transitions where both pins changed
+     * at once (missed edge or noise) as errors instead.
+     */
+    void quadrature_isr(void);
+
+    /**
+     * @brief Read the tick count and the time of the last edge consistently.
+     * @param sample The sample, with the counting direction applied.
+     */
+    void sample(EncoderSample &sample);
+
+    /**
+     * @brief Sample several encoders and the current time in a single critical
+     * section, so that odometry and velocities are computed from one coherent
+     * snapshot.
+     * @param encoders The encoders.
+     * @param samples The samples, with the counting directions applied.
+     * @param count The number of encoders.
+     * @return The time of the snapshot (in us, micros()).
+     */
+    static unsigned long sample_all(Encoder *const *encoders,
+                                    EncoderSample *samples,
+                                    uint8_t count);
+
+    /**
+     * @brief Get the number of illegal transitions seen by quadrature_isr().
+     * @return The error count.
+     */
+    uint16_t get_error_count(void);
+
     /**
      * @brief Get the current tick count of the encoder.
      * @return The current tick count as a 32-bit integer.
@@ -47,11 +90,43 @@ class Encoder {
      */
     void init_pins(void);
 
+    /**
+     * @brief Read the tick count and the time of the last edge, with interrupts
+     * already disabled.
+     * @param sample The sample, with the counting direction applied.
+     */
+    void read_(EncoderSample &sample);
+
    private:
-    uint8_t pin_a_;           ///!< The digital pin connected to encoder phase A.
-    uint8_t pin_b_;           ///!< The digital pin connected to encoder phase B.
-    bool reverse_;            ///!< Flag to reverse the counting direction.
-    volatile int32_t ticks_;  ///!< The current tick count.
+    uint8_t pin_a_;  ///!< The digital pin connected to encoder phase A.
+    uint8_t pin_b_;  ///!< The digital pin connected to encoder phase B.
+
+   protected:
+    /**
+     * @brief Count the transition from the previous quadrature state.
+     * @param state The new state, (A << 1) | B.
+     */
+    inline void decode_(uint8_t state) {
+        int8_t step = QUADRATURE_TABLE_[(state_ << 2) | state];
+        state_ = state;
+        if (step == QUADRATURE_ILLEGAL_) {
+            errors_++;
+        } else if (step != 0) {
+            ticks_ += step;
+            edge_time_ = micros();
+        }
+    }
+
+    /// Marks a transition where both pins changed in QUADRATURE_TABLE_.
+    static const int8_t QUADRATURE_ILLEGAL_ = 2;
+    /// Tick increment indexed by (previous state << 2) | state.
+    static const int8_t QUADRATURE_TABLE_[16];
+
+    bool reverse_;                      ///!< Flag to reverse the counting direction.
+    volatile int32_t ticks_;            ///!< The current tick count.
+    volatile unsigned long edge_time_;  ///!< Time of the last counted edge (in us).
+    uint8_t state_;                     ///!< Last quadrature state, (A << 1) | B.
+    volatile uint16_t errors_;          ///!< Number of illegal quadrature transitions.
 };
 
 #endif  // !ENCODER_HPP
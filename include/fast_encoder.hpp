@@ -0,0 +1,87 @@
+#ifndef FAST_ENCODER_HPP
+#define FAST_ENCODER_HPP
+
+#include <Arduino.h>
+
+#include "encoder.hpp"
+
+// The pin to port mapping of the ATmega168/328 Arduino boards is fixed: digital
+// pins 0-7 are PORTD, 8-13 are PORTB and 14-19 (A0-A5) are PORTC.
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || \
+    defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+#define FAST_ENCODER_DIRECT_PORT 1
+#else
+#define FAST_ENCODER_DIRECT_PORT 0
+#endif
+
+/**
+ * @class FastEncoder
+ * @brief Encoder with the pins resolved at compile time.
+ *
+ * @details Encoder::tick_isr() reads phase B with digitalRead(), which looks up the
+ * port and bitmask of the pin in flash on every edge. Here the pins are template
+ * parameters, so on ATmega168/328 boards the read compiles to a single bit test
+ * of the input register. Other boards fall back to digitalRead().
+ *
+ * FastEncoder is an Encoder and can be passed to MotorDriver as is. Its
+ * tick_isr() and quadrature_isr() must be called on the FastEncoder itself.
+ *
+ * @tparam PinA The digital pin connected to encoder signal A.
+ * @tparam PinB The digital pin connected to encoder signal B.
+ * @tparam Reverse Set to true to reverse the counting direction.
+ */
+template <uint8_t PinA, uint8_t PinB, bool Reverse = false>
+class FastEncoder : public Encoder {
+#if FAST_ENCODER_DIRECT_PORT
+    static_assert(PinA < 20 && PinB < 20,
+                  "FastEncoder: pins are not digital pins of this board");
+#endif
+
+   public:
+    /**
+     * @brief Constructor for the FastEncoder class.
+     */
+    FastEncoder() : Encoder(PinA, PinB, Reverse) {}
+
+    /**
+     * @brief Interrupt service routine (ISR) called when an encoder tick is detected.
+     * @details This ISR should be connected to PinA on RISING.
+     */
+    inline void tick_isr(void) {
+        if (read_pin_<PinB>()) {
+            ticks_--;
+        } else {
+            ticks_++;
+        }
+        edge_time_ = micros();
+    }
+
+    /**
+     * @brief Interrupt service routine (ISR) for 4x quadrature decoding, see
+     * Encoder::quadrature_isr().
+     */
+    inline void quadrature_isr(void) {
+        decode_((read_pin_<PinA>() ? 2 : 0) | (read_pin_<PinB>() ? 1 : 0));
+    }
+
+   private:
+    /**
+     * @brief Read the level of a pin.
+     * @tparam Pin The digital pin.
+     * @return true if the pin is HIGH.
+     */
+    template <uint8_t Pin>
+    static inline bool read_pin_(void) {
+#if FAST_ENCODER_DIRECT_PORT
+        // Both conditions are constant, only one register bit test remains.
+        if (Pin < 8) return PIND & _BV(Pin & 7);
+        if (Pin < 14) return PINB & _BV((Pin - 8) & 7);
+        return PINC & _BV((Pin - 14) & 7);
+#else
+        return digitalRead(Pin) == HIGH;
+#endif
+    }
+
+};
+
+#endif  // !FAST_ENCODER_HPP
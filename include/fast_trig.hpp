@@ -0,0 +1,44 @@
+#ifndef FAST_TRIG_HPP
+#define FAST_TRIG_HPP
+
+#include <Arduino.h>
+
+/**
+ * @file fast_trig.hpp
+ * @brief Table-driven sine and cosine for the float odometry (ODOMETRY_TRIG_TABLE).
+ *
+ * @details A quarter wave of 65 Q15 samples (130 bytes) is stored in PROGMEM and
+ * linearly interpolated. The angle is quantized to 2^16 steps per turn. The
+ * maximum error is bounded by:
+ * - interpolation: (PI / 2 / 64)^2 / 8 = 7.5e-5
+ * - angle quantization: PI / 2^16 = 4.8e-5
+ * - table quantization: 1.5e-5
+ *
+ * i.e. 1.4e-4 in total (1.3e-4 measured by the native_bench environment), compared
+ * to the ~3e-8 of libm's float sin() and cos(). In the odometry, this is at most
+ * 0.14 mm of position error per meter travelled.
+ */
+
+/**
+ * @brief Compute the sine and cosine of an angle.
+ * @param angle The angle in radians, with a magnitude lower than 1e5.
+ * @param sine The sine of the angle.
+ * @param cosine The cosine of the angle.
+ */
+void fast_sincos(float angle, float &sine, float &cosine);
+
+/**
+ * @brief Compute the sine of an angle, see fast_sincos().
+ * @param angle The angle in radians, with a magnitude lower than 1e5.
+ * @return The sine of the angle.
+ */
+float fast_sin(float angle);
+
+/**
+ * @brief Compute the cosine of an angle, see fast_sincos().
+ * @param angle The angle in radians, with a magnitude lower than 1e5.
+ * @return The cosine of the angle.
+ */
+float fast_cos(float angle);
+
+#endif  // !FAST_TRIG_HPP
@@ -0,0 +1,73 @@
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <Arduino.h>
+
+/**
+ * @file fixed_point.hpp
+ * @brief Helpers for the fixed-point odometry pipeline (FIXED_POINT_ODOMETRY).
+ *
+ * @details Values are stored in signed 32-bit integers with a given number of
+ * fractional bits, noted Qn. Conversions from float are meant to be done once,
+ * when precomputing scale factors, so that the control loop only uses 32-bit
+ * integer multiplies, shifts and at most one divide.
+ *
+ * Angles are binary angles: an unsigned 32-bit integer where 2^32 is a full turn,
+ * so that wrapping around +/-PI is free.
+ */
+
+/**
+ * @brief Convert a float to a fixed-point value with rounding.
+ * @param value The value to convert.
+ * @param frac_bits The number of fractional bits of the result.
+ * @return The fixed-point value.
+ */
+inline int32_t float_to_fixed(float value, uint8_t frac_bits) {
+    float scaled = value * float(1UL << frac_bits);
+    return int32_t(scaled >= 0 ? scaled + 0.5f : scaled - 0.5f);
+}
+
+/**
+ * @brief Convert a Q16 value to float.
+ * @param value The Q16 value.
+ * @return The float value.
+ */
+inline float q16_to_float(int32_t value) { return value * (1.0f / 65536.0f); }
+
+/**
+ * @brief Radians per binary angle unit (2 * PI / 2^32).
+ */
+#define BINARY_ANGLE_TO_RAD 1.4629180792671596e-09
+
+/**
+ * @brief Binary angle of a quarter turn.
+ */
+#define BINARY_ANGLE_QUARTER 0x40000000UL
+
+/**
+ * @brief Convert a binary angle to radians, within [-PI, PI).
+ * @param angle The binary angle.
+ * @return The angle in radians.
+ */
+inline float binary_angle_to_rad(uint32_t angle) {
+    return int32_t(angle) * float(BINARY_ANGLE_TO_RAD);
+}
+
+/**
+ * @brief Fixed-point sine.
+ * @details 5th order minimax polynomial of the quarter wave, evaluated with 32-bit
+ * integer multiplies. The maximum error is 1.5e-4, including the quantization of
+ * the angle to 16 bits.
+ * @param angle The binary angle.
+ * @return The sine (Q15).
+ */
+int32_t fixed_sin(uint32_t angle);
+
+/**
+ * @brief Fixed-point cosine, see fixed_sin().
+ * @param angle The binary angle.
+ * @return The cosine (Q15).
+ */
+inline int32_t fixed_cos(uint32_t angle) { return fixed_sin(angle + BINARY_ANGLE_QUARTER); }
+
+#endif  // !FIXED_POINT_HPP
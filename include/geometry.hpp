@@ -0,0 +1,101 @@
+#ifndef GEOMETRY_HPP
+#define GEOMETRY_HPP
+
+#include <Arduino.h>
+
+#include "configuration.hpp"
+
+/**
+ * @struct Geometry
+ * @brief Dimensions of the robot used by the kinematics and the odometry.
+ *
+ * @details The derived constants are constexpr, so that the ones of
+ * DEFAULT_GEOMETRY are folded at compile time. The motor drivers and controller
+ * cache them when the geometry changes, leaving only multiplies in the control
+ * loop.
+ */
+struct Geometry {
+    float wheel_radius;         ///< Radius of the wheels (in m).
+    float dist_between_wheels;  ///< Distance between the wheels (in m).
+    uint16_t ticks_per_rev;     ///< Encoder ticks per wheel revolution (1x).
+
+    /**
+     * @brief Encoder counts per wheel revolution seen by the motor drivers.
+     */
+    constexpr uint16_t counts_per_rev() const {
+        return ticks_per_rev * ENCODER_COUNTS_PER_TICK;
+    }
+
+    /**
+     * @brief Distance travelled by a wheel per encoder count (in m).
+     */
+    constexpr float meters_per_count() const {
+        return 2 * PI * wheel_radius / counts_per_rev();
+    }
+
+    /**
+     * @brief Check that the dimensions are positive and that the encoder counts
+     * fit 16 bits.
+     */
+    constexpr bool is_valid() const {
+        return wheel_radius > 0.0 && dist_between_wheels > 0.0 && ticks_per_rev > 0 &&
+               ticks_per_rev <= UINT16_MAX / ENCODER_COUNTS_PER_TICK;
+    }
+};
+
+/**
+ * @brief Geometry of configuration.hpp, used until another one is set or loaded.
+ */
+constexpr Geometry DEFAULT_GEOMETRY = {
+    WHEEL_RADIUS, DIST_BETWEEN_WHEELS, ENCODER_TICKS_PER_REVOLUTION};
+
+static_assert(DEFAULT_GEOMETRY.is_valid(), "invalid robot geometry in configuration");
+
+/**
+ * @enum KinematicsModel
+ * @brief How the wheel velocities relate to the velocity of the robot.
+ */
+typedef enum {
+    KINEMATICS_DIFF_DRIVE = 0,  ///< Wheels rolling without slipping.
+    KINEMATICS_SKID_STEER = 1,  ///< Wheels slipping sideways when turning.
+} KinematicsModel;
+
+/**
+ * @struct Kinematics
+ * @brief Kinematics model of the robot.
+ *
+ * @details Both models drive every wheel of a side at the velocity of that side.
+ * The skid-steer model accounts for the lateral slip of the wheels by turning
+ * around a wider effective wheel base, the measured one times the slip factor.
+ */
+struct Kinematics {
+    KinematicsModel model;  ///< The kinematics model.
+    float slip_factor;      ///< Effective over measured wheel base (skid-steer).
+
+    /**
+     * @brief Effective distance between the wheels (in m).
+     */
+    constexpr float wheel_base(const Geometry &geometry) const {
+        return model == KINEMATICS_SKID_STEER
+                   ? geometry.dist_between_wheels * slip_factor
+                   : geometry.dist_between_wheels;
+    }
+
+    /**
+     * @brief Check that the model is known and that the slip factor does not
+     * shrink the wheel base.
+     */
+    constexpr bool is_valid() const {
+        return model == KINEMATICS_DIFF_DRIVE ||
+               (model == KINEMATICS_SKID_STEER && slip_factor >= 1.0);
+    }
+};
+
+/**
+ * @brief Kinematics of configuration.hpp.
+ */
+constexpr Kinematics DEFAULT_KINEMATICS = {KINEMATICS_MODEL, SKID_STEER_SLIP_FACTOR};
+
+static_assert(DEFAULT_KINEMATICS.is_valid(), "invalid kinematics in configuration");
+
+#endif  // !GEOMETRY_HPP
@@ -0,0 +1,72 @@
+#ifndef LINE_READER_HPP
+#define LINE_READER_HPP
+
+#include <Arduino.h>
+
+#include "configuration.hpp"
+
+/**
+ * @enum LineStatus
+ * @brief Enumerates the possible outcomes of feeding a byte to the LineReader.
+ */
+enum class LineStatus { PENDING, READY, DROPPED };
+
+/**
+ * @class LineReader
+ * @brief Fixed-capacity line assembler for the text protocol.
+ *
+ * @details Bytes are copied from the Arduino core RX ring into a statically sized
+ * buffer, so the cost per byte is constant and no heap is used. Lines that do not
+ * fit are counted and dropped up to the next newline.
+ */
+class LineReader {
+   public:
+    /**
+     * @brief Constructor for the LineReader class.
+     */
+    LineReader();
+
+    /**
+     * @brief Feed a received byte.
+     * @param c The received byte.
+     * @return READY when a complete line is available through get_line(),
+     * DROPPED when a too long line has just been dropped, PENDING otherwise.
+     */
+    LineStatus push(char c);
+
+    /**
+     * @brief Get the last complete line, null-terminated and without its newline.
+     * @details The line is only valid until the next call to push().
+     * @return The line.
+     */
+    const char* get_line(void);
+
+    /**
+     * @brief Drop any partially received line.
+     */
+    void clear(void);
+
+    /**
+     * @brief Get the number of lines dropped because they were too long.
+     * @return The number of overflows.
+     */
+    uint16_t get_overflow_count(void);
+
+   private:
+    char buffer_[SERIAL_LINE_BUFFER_SIZE];  ///< Line being received.
+    uint8_t len_;                           ///< Number of bytes in the buffer.
+    bool discarding_;     ///< Dropping bytes up to the next newline.
+    bool line_ready_;     ///< The buffer holds a complete line.
+    uint16_t overflows_;  ///< Number of dropped lines.
+};
+
+/**
+ * @brief Parse a signed decimal integer, skipping leading blanks.
+ * @param cursor Position in the line, advanced past the integer on success.
+ * @param value The parsed value.
+ * @return true if an integer was parsed, false otherwise (including values out of
+ * the range of int32_t, from -INT32_MAX).
+ */
+bool parse_int(const char*& cursor, int32_t& value);
+
+#endif  // !LINE_READER_HPP
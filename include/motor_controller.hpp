@@ -4,8 +4,13 @@
 #include <Arduino.h>
 
 #include "configuration.hpp"
+#include "geometry.hpp"
 #include "motor_driver.hpp"
-#include "timer_api.hpp"
+#include "parameter_store.hpp"
+#include "position_profile.hpp"
+#include "relay_autotuner.hpp"
+#include "sample_recorder.hpp"
+#include "velocity_profile.hpp"
 
 // TODO: Add methods to update motor PID values.
 
@@ -30,22 +35,80 @@ typedef struct {
     float w;  ///< Angular velocity around the z-axis.
 } CmdVel;
 
+/**
+ * @enum WheelSide
+ * @brief Side of the robot a wheel is on, which sets its velocity.
+ */
+typedef enum { SIDE_LEFT = 0, SIDE_RIGHT = 1 } WheelSide;
+
+/**
+ * @enum MoveState
+ * @brief State of a position move.
+ */
+typedef enum {
+    MOVE_IDLE = 0,      ///< No move since startup.
+    MOVE_RUNNING = 1,   ///< Following the profiles.
+    MOVE_REACHED = 2,   ///< Ended within the POSITION_TOLERANCE_* of the target.
+    MOVE_TIMEOUT = 3,   ///< Not within the tolerances POSITION_SETTLE_TIMEOUT_MS after
+                        ///< the profiles ended, stopped anyway.
+    MOVE_CANCELLED = 4  ///< Interrupted by another command.
+} MoveState;
+
+/**
+ * @struct MoveStatus
+ * @brief Outcome of a position move.
+ */
+typedef struct {
+    MoveState state;  ///< The state.
+    float distance;   ///< Distance travelled since the start (in m).
+    float angle;      ///< Angle turned since the start (in rad).
+} MoveStatus;
+
+/**
+ * @struct LoopTiming
+ * @brief Timing statistics of the control loop updates, used to measure jitter.
+ */
+typedef struct {
+    uint32_t min_period;   ///< Shortest period between two updates (in us).
+    uint32_t max_period;   ///< Longest period between two updates (in us).
+    uint32_t mean_period;  ///< Mean period between two updates (in us).
+    uint16_t count;        ///< Number of periods measured.
+} LoopTiming;
+
 /**
  * @class MotorController
- * @brief A class for controlling two motors and computing the robot's pose.
+ * @brief A class for controlling the motors of the wheels and computing the robot's
+ * pose.
+ *
+ * @details The wheels are identified by their index in the array of motor drivers
+ * given to the constructor. All the wheels of a side are driven at the same
+ * velocity, and the odometry uses the mean distance travelled on each side.
  */
 class MotorController {
    public:
     /**
      * @brief Constructor for the MotorController class.
      *
-     * @param left_motor A pointer to the left motor driver.
-     * @param right_motor A pointer to the right motor driver.
-     * @param dist_between_wheels The distance between the robot's two wheels.
+     * @param motors The array of motor drivers, one per wheel. Either all or none
+     * of them have an encoder.
+     * @param sides The side of each wheel.
+     * @param wheel_count The number of wheels, at most MAX_WHEELS.
+     * @param geometry The dimensions of the robot, also applied to the motor
+     * drivers.
+     * @param kinematics The kinematics model.
+     */
+    MotorController(MotorDriver *motors,
+                    const WheelSide *sides,
+                    uint8_t wheel_count,
+                    const Geometry &geometry = DEFAULT_GEOMETRY,
+                    const Kinematics &kinematics = DEFAULT_KINEMATICS);
+
+    /**
+     * @brief Get the number of wheels.
+     *
+     * @return The number of wheels.
      */
-    MotorController(MotorDriver *left_motor,
-                    MotorDriver *right_motor,
-                    float dist_between_wheels);
+    uint8_t get_wheel_count();
 
     /**
      * @brief Get the current pose of the robot.
@@ -56,10 +119,13 @@ class MotorController {
 
     /**
      * @brief Set the commanded velocity for the robot.
+     * @details The velocity is reached with a ramp limited by the CMD_VEL_MAX_*
+     * acceleration and jerk settings.
      *
      * @param cmd_vel The desired linear and angular velocity.
+     * @return True if the command was applied, false if a velocity is not finite.
      */
-    void set_cmd_vel(CmdVel cmd_vel);
+    bool set_cmd_vel(CmdVel cmd_vel);
 
     /**
      * @brief Reset the motor controller to its initial state.
@@ -67,10 +133,26 @@ class MotorController {
     void reset(void);
 
     /**
-     * @brief Run the motor controller's control loop.
-     * This function should be called on every iteration of the main loop.
+     * @brief Run one update of the velocity loop: velocity profile, encoders and
+     * motors. Must be called at MOTOR_RUN_FREQUENCY by the velocity task of the
+     * scheduler. It does nothing when the velocity loop is run by the timer
+     * interrupt (CONTROL_LOOP_TIMER_ISR).
+     */
+    void update_velocity(void);
+
+    /**
+     * @brief Integrate the distances travelled by the wheels since the last update
+     * into the pose. Must be called at ODOMETRY_FREQUENCY by the odometry task of
+     * the scheduler, from the main loop in both modes.
      */
-    void run(void);
+    void update_odometry(void);
+
+    /**
+     * @brief Run one update of the velocity loop. Must be called from the control
+     * timer interrupt at MOTOR_RUN_FREQUENCY when CONTROL_LOOP_TIMER_ISR is enabled.
+     * @details Setpoints posted by the main loop are applied first.
+     */
+    void control_isr(void);
 
     /**
      * @brief Print the current pose of the robot.
@@ -102,18 +184,17 @@ class MotorController {
     /**
      * @brief Moves the motors in open-loop mode.
      *
-     * @param left_pwm The PWM value for the left motor.
-     * @param right_pwm The PWM value for the right motor.
+     * @param left_pwm The PWM value for the left motors.
+     * @param right_pwm The PWM value for the right motors.
      */
     void move_open_loop(uint8_t left_pwm, uint8_t right_pwm);
 
     /**
      * @brief Get the current status of the motors.
      *
-     * @param left_motor The status of the left motor.
-     * @param right_motor The status of the right motor.
+     * @param motors Array of MAX_WHEELS statuses, filled for each wheel.
      */
-    void get_motor_status(MotorData &left_motor, MotorData &right_motor);
+    void get_motor_status(MotorData *motors);
 
     /**
      * @brief Reset the robot's pose to (0, 0, 0).
@@ -121,42 +202,375 @@ class MotorController {
     void reset_pose();
 
     /**
-     * @brief Update the PID gains for the motors.
+     * @brief Update the PID gains for the motors, at all velocities.
      *
      * @param pid_gains The new PID gains.
+     * @return True if the gains were applied, false if a gain is not finite.
      */
-    void update_motor_pids(pid_gains_t pid_gains);
+    bool update_motor_pids(pid_gains_t pid_gains);
 
     /**
      * @brief Get the current PID gains for the motors.
      *
-     * @return The current PID gains of the motors.
+     * @return The current PID gains of the first motor.
      */
     pid_gains_t get_motor_pids();
 
+    /**
+     * @brief Get the PID gains currently used by a wheel, interpolated from its
+     * gain schedule.
+     *
+     * @param wheel The index of the wheel, less than get_wheel_count().
+     * @return The current PID gains of the wheel.
+     */
+    pid_gains_t get_motor_pids(uint8_t wheel);
+
+    /**
+     * @brief Set a breakpoint of the gain schedule of a wheel, see
+     * MotorDriver::set_gain_breakpoint().
+     *
+     * @param wheel The index of the wheel.
+     * @param index The index of the breakpoint.
+     * @param breakpoint The breakpoint, whose velocity and gains must be finite.
+     * @return True if the breakpoint was set.
+     */
+    bool set_gain_breakpoint(uint8_t wheel,
+                             uint8_t index,
+                             const GainBreakpoint &breakpoint);
+
+    /**
+     * @brief Get the gain schedule of a wheel.
+     *
+     * @param wheel The index of the wheel.
+     * @param breakpoints Array of PID_GAIN_SCHEDULE_SIZE breakpoints to fill.
+     * @return The number of breakpoints, 0 for an invalid wheel.
+     */
+    uint8_t get_gain_schedule(uint8_t wheel, GainBreakpoint *breakpoints);
+
+    /**
+     * @brief Update the feed-forward gains for the motors.
+     *
+     * @param gains The new feed-forward gains.
+     * @return True if the gains were applied, false if a gain is not finite.
+     */
+    bool update_feedforward_gains(FeedForwardGains gains);
+
+    /**
+     * @brief Get the current feed-forward gains for the motors.
+     *
+     * @return The current feed-forward gains of the motors.
+     */
+    FeedForwardGains get_feedforward_gains();
+
+    /**
+     * @brief Get the number of control loop updates since startup.
+     *
+     * @return The number of control ticks.
+     */
+    uint32_t get_tick_count();
+
+    /**
+     * @brief Get the time of the last control loop update.
+     *
+     * @return The time of the last control tick (in milliseconds).
+     */
+    unsigned long get_tick_time();
+
+    /**
+     * @brief Get the timing statistics of the control loop updates since the last
+     * call, and reset them.
+     *
+     * @param timing The timing statistics.
+     */
+    void get_loop_timing(LoopTiming &timing);
+
+    /**
+     * @brief Get the number of illegal quadrature transitions seen by the encoders.
+     *
+     * @return The error count.
+     */
+    uint32_t get_encoder_error_count();
+
+    /**
+     * @brief Start a relay auto-tuning experiment on all the wheels.
+     * @details The wheels are driven open loop around the setpoint, so the robot
+     * moves forward during the experiment. On success, the PID gains of each
+     * wheel are computed with the tuning rule and applied, then the motors stop.
+     * Any velocity or open-loop command cancels the experiment.
+     *
+     * @param setpoint The wheel velocity to oscillate around (in m/s).
+     * @param amplitude The relay amplitude (in PWM).
+     * @param rule The TuningRule used to compute the gains.
+     * @return True if the experiment started, false without encoders or with
+     * invalid parameters.
+     */
+    bool start_autotune(float setpoint, uint8_t amplitude, uint8_t rule);
+
+    /**
+     * @brief Get the state of the auto-tuning experiment, combined over the
+     * wheels: RUNNING while any wheel runs, FAILED if any wheel failed.
+     *
+     * @return The state.
+     */
+    AutotuneState get_autotune_state();
+
+    /**
+     * @brief Get the ultimate gains and periods measured by the last auto-tuning
+     * experiment.
+     *
+     * @param results Array of MAX_WHEELS results, filled for each wheel.
+     */
+    void get_autotune_result(AutotuneResult *results);
+
+    /**
+     * @brief Start a position move: travel a distance and turn an angle, following
+     * trapezoidal profiles from rest to rest, then stop.
+     * @details An outer loop adds the error between the profiled and measured
+     * positions, from the wheel distances, to the velocity commands of the wheels.
+     * Any velocity or open-loop command cancels the move.
+     *
+     * @param distance The distance to travel (in m, negative backwards).
+     * @param angle The angle to turn (in rad, positive counterclockwise).
+     * @return True if the move started, false without encoders or with invalid
+     * parameters.
+     */
+    bool start_move(float distance, float angle);
+
+    /**
+     * @brief Get the outcome of the last move, once, when it has ended.
+     *
+     * @param status The outcome.
+     * @return True if a move ended since the last call.
+     */
+    bool get_move_event(MoveStatus &status);
+
+    /**
+     * @brief Start recording the state of the wheels at each control tick,
+     * discarding the previous recording.
+     *
+     * @param trigger The RecorderTrigger starting the recording.
+     * @param divider Control ticks per record.
+     * @return True if started, false with invalid parameters.
+     */
+    bool start_recording(uint8_t trigger, uint8_t divider);
+
+    /**
+     * @brief Get the state and contents of the sample recorder.
+     *
+     * @param status The status.
+     */
+    void get_recorder_status(RecorderStatus &status);
+
+    /**
+     * @brief Get a record of the sample recorder.
+     *
+     * @param index The index of the record, 0 being the oldest.
+     * @param wheels The state of each wheel, MAX_WHEELS entries.
+     * @return True if the record exists.
+     */
+    bool get_record(uint8_t index, WheelSample *wheels);
+
+    /**
+     * @brief Change the dimensions of the robot, and reset its pose.
+     *
+     * @param geometry The new dimensions.
+     * @return True if the dimensions are valid (positive, ticks fitting 16 bits in
+     * 4x mode) and were applied.
+     */
+    bool set_geometry(const Geometry &geometry);
+
+    /**
+     * @brief Get the dimensions of the robot.
+     *
+     * @param geometry The dimensions.
+     */
+    void get_geometry(Geometry &geometry);
+
+    /**
+     * @brief Collect the runtime parameters to be saved: geometry, feed-forward
+     * gains and gain schedules.
+     *
+     * @param params The parameters.
+     */
+    void get_parameters(Parameters &params);
+
+    /**
+     * @brief Apply saved runtime parameters, skipping the invalid ones.
+     *
+     * @param params The parameters.
+     */
+    void set_parameters(const Parameters &params);
+
    private:
     /**
-     * @brief Compute and update the robot's pose based on wheel travelled distances.
+     * @struct Setpoint
+     * @brief Setpoint handed from the main loop to the control loop.
+     */
+    typedef struct {
+        CmdVel cmd_vel;     ///< Closed-loop velocity command.
+        uint8_t left_pwm;   ///< Open-loop PWM value of the left motors.
+        uint8_t right_pwm;  ///< Open-loop PWM value of the right motors.
+        bool open_loop;     ///< Apply the PWM values instead of cmd_vel.
+    } Setpoint;
+
+    /**
+     * @brief Run one update of the velocity loop: velocity profile and motors.
+     */
+    void update_velocity_();
+
+    /**
+     * @brief Apply a setpoint to the motors.
+     *
+     * @param setpoint The setpoint to apply.
+     */
+    void apply_setpoint_(const Setpoint &setpoint);
+
+    /**
+     * @brief Apply a setpoint, or hand it over to the control loop interrupt.
+     *
+     * @param setpoint The setpoint to apply.
+     */
+    void post_setpoint_(const Setpoint &setpoint);
+
+    /**
+     * @brief Drive the motors from the auto-tuners, and apply the gains once all
+     * the experiments are over.
+     *
+     * @param time The time of the encoder sample (in us).
+     */
+    void update_autotune_(unsigned long time);
+
+    /**
+     * @brief Stop the auto-tuning experiment, if running.
+     */
+    void cancel_autotune_();
+
+    /**
+     * @brief Step the position profiles and drive the wheels to follow them, then
+     * end the move once settled.
+     */
+    void update_move_();
+
+    /**
+     * @brief End the position move, if running. The velocity ramps continue from
+     * the current command.
+     *
+     * @param state The outcome of the move.
+     */
+    void end_move_(MoveState state);
+
+    /**
+     * @brief Get the sum of the distances travelled by the wheels of each side.
+     *
+     * @param side_dist The distance of each side (in m).
+     */
+    void get_side_distances_(float *side_dist);
+
+    /**
+     * @brief Get the distance travelled and the angle turned since the start of the
+     * move, from the wheel distances.
+     *
+     * @param distance The distance (in m).
+     * @param angle The angle (in rad).
+     */
+    void get_move_progress_(float &distance, float &angle);
+
+    /**
+     * @brief Apply the dimensions of the robot to the motor drivers and cache the
+     * constants of the kinematics.
+     *
+     * @param geometry The dimensions.
+     */
+    void apply_geometry_(const Geometry &geometry);
+
+    /**
+     * @brief Mask the control loop interrupt, when enabled, to modify its state
+     * from the main loop.
+     */
+    void lock_();
+
+    /**
+     * @brief Unmask the control loop interrupt, see lock_().
+     */
+    void unlock_();
+
+    /**
+     * @brief Compute and update the robot's pose based on the mean distances
+     * travelled by the wheels of each side.
+     * @details Only the distances are read with the control loop interrupt masked.
      */
     void compute_pose_();
 
     /**
      * @brief Compute the wheel speeds required to achieve the commanded velocity,
-     * based on the Unicycle Kinematic Model.
+     * based on the Unicycle Kinematic Model with the effective wheel base.
+     *
+     * @param accel_x The planned linear acceleration, fed forward.
+     * @param accel_w The planned angular acceleration, fed forward.
      */
-    void compute_wheel_speeds_();
+    void compute_wheel_speeds_(float accel_x, float accel_w);
 
    private:
     Pose pose_;                  ///< The current pose of the robot.
-    CmdVel cmd_vel_;             ///< The commanded velocity for the robot.
-    float dist_between_wheels_;  ///< The distance between the robot's two wheels.
-    float prev_left_dist_;       ///< The previous distance travelled by the left wheel.
-    float prev_right_dist_;  ///< The previous distance travelled by the right wheel.
+    CmdVel cmd_vel_;             ///< The profiled velocity of the robot.
+    VelocityProfile linear_profile_;   ///< Ramp of the linear velocity.
+    VelocityProfile angular_profile_;  ///< Ramp of the angular velocity.
+    Geometry geometry_;          ///< The dimensions of the robot.
+    Kinematics kinematics_;      ///< The kinematics model.
+    float half_wheel_base_;      ///< Half the effective distance between the wheels.
+    float inverse_wheel_base_;   ///< Inverse of the effective distance between wheels.
+    float prev_side_dist_[2];    ///< Previous sum of the wheel distances of each side.
+    float side_scale_[2];        ///< Inverse of the number of wheels of each side.
+#if FIXED_POINT_ODOMETRY
+    int32_t pose_x_q16_;     ///< The x-coordinate of the robot (Q16).
+    int32_t pose_y_q16_;     ///< The y-coordinate of the robot (Q16).
+    uint32_t heading_;       ///< The orientation of the robot (binary angle).
+    int32_t heading_scale_;  ///< Turns per meter of wheel travel difference (Q16).
+    int32_t prev_side_dist_q16_[2];  ///< Previous sum of the distances of each side.
+    int32_t side_remainder_q16_[2];  ///< Distance not yet averaged on each side.
+#endif
+    uint32_t tick_count_;    ///< Number of control loop updates.
+    unsigned long tick_time_;  ///< Time of the last control loop update (in ms).
+
+    // Lock-free handoff between the main loop and the control loop interrupt. The
+    // interrupt never runs concurrently with itself and always completes before
+    // the main loop resumes.
+    Setpoint setpoints_[2];             ///< Double buffer of posted setpoints.
+    volatile uint8_t setpoint_index_;   ///< Index of the last posted setpoint.
+    volatile bool setpoint_pending_;    ///< A posted setpoint awaits the control loop.
+    volatile uint8_t state_seq_;        ///< Incremented around each update, readers
+                                        ///< retry if it changed while copying.
+
+    // Loop timing statistics
+    unsigned long last_update_us_;  ///< Time of the last update (in us).
+    uint32_t period_min_;           ///< Shortest period (in us).
+    uint32_t period_max_;           ///< Longest period (in us).
+    uint32_t period_sum_;           ///< Sum of the periods (in us).
+    uint16_t period_count_;         ///< Number of periods measured.
+
+    // Auto-tuning
+    RelayAutotuner tuners_[MAX_WHEELS];  ///< Relay experiment on each wheel.
+    TuningRule tuning_rule_;             ///< Rule applied at the end of the experiment.
+    bool autotuning_;                    ///< The auto-tuners drive the motors.
+
+    SampleRecorder recorder_;  ///< Records the wheels at each control tick.
+
+    // Position moves
+    PositionProfile linear_move_;   ///< Profile of the distance of the move.
+    PositionProfile angular_move_;  ///< Profile of the angle of the move.
+    float move_start_[2];           ///< Distance of each side at the start.
+    uint16_t move_settle_ticks_;    ///< Control ticks since the profiles ended.
+    MoveState move_state_;          ///< State of the current move.
+    MoveStatus move_status_;        ///< Outcome of the last move that ended.
+    bool move_event_;               ///< move_status_ not read yet.
 
    private:
-    MotorDriver *left_motor_;      ///< Pointer to the left motor driver.
-    MotorDriver *right_motor_;     ///< Pointer to the right motor driver.
-    TimerAPI motor_update_timer_;  ///< Timer for motor control updates.
+    MotorDriver *motors_;            ///< The motor drivers, one per wheel.
+    Encoder *encoders_[MAX_WHEELS];  ///< The encoders of the motor drivers.
+    WheelSide sides_[MAX_WHEELS];    ///< The side of each wheel.
+    uint8_t wheel_count_;            ///< The number of wheels.
+    uint8_t side_count_[2];          ///< The number of wheels of each side.
+    bool has_encoders_;              ///< All the motor drivers have an encoder.
 };
 
 #endif  // MOTOR_CONTROLLER_HPP
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 
+#include "configuration.hpp"
 #include "encoder.hpp"
 #include "pid.hpp"
 
@@ -19,6 +20,36 @@ typedef struct {
     float rpm;               ///< Revolutions per minute (RPM) of the motor.
 } MotorData;
 
+/**
+ * @struct WheelSample
+ * @brief Compact state of a wheel at a control tick, see SampleRecorder.
+ */
+typedef struct __attribute__((packed)) {
+    int16_t setpoint;  ///< Velocity setpoint (in mm/s), 0 in open loop.
+    int16_t velocity;  ///< Measured velocity (in mm/s).
+    int16_t pwm;       ///< PWM applied, negative when reversing.
+    int8_t ticks;      ///< Encoder counts since the previous tick, saturated.
+} WheelSample;
+
+/**
+ * @struct FeedForwardGains
+ * @brief Motor model used as feed-forward: pwm = ks * sign(v) + kv * v + ka * a.
+ */
+typedef struct {
+    float ks;  ///< Static friction, PWM needed to start moving (deadband).
+    float kv;  ///< Velocity gain (PWM per m/s).
+    float ka;  ///< Acceleration gain (PWM per m/s^2).
+} FeedForwardGains;
+
+/**
+ * @struct GainBreakpoint
+ * @brief Breakpoint of a gain schedule: PID gains used at a velocity setpoint.
+ */
+typedef struct {
+    float velocity;     ///< Magnitude of the velocity setpoint (in m/s).
+    pid_gains_t gains;  ///< PID gains at this velocity.
+} GainBreakpoint;
+
 /**
  * @enum MotorDirection
  * @brief Enumerates the possible motor rotation directions: Clockwise (CW),
@@ -79,6 +110,20 @@ class MotorDriver {
      */
     void run(void);
 
+    /**
+     * @brief Run the motor control loop from an encoder sample taken by the caller,
+     * e.g. with Encoder::sample_all() to share one sample time between motors.
+     * @param sample The encoder sample.
+     * @param time The time at which the sample was taken (in us, micros()).
+     */
+    void run(const EncoderSample &sample, unsigned long time);
+
+    /**
+     * @brief Get the encoder of the motor.
+     * @return The encoder, nullptr in open-loop only mode.
+     */
+    Encoder *get_encoder();
+
     /**
      * @brief Print the current status and data of the motor.
      */
@@ -93,8 +138,10 @@ class MotorDriver {
     /**
      * @brief Set the desired linear velocity of the motor (Closed-Loop mode).
      * @param velocity The desired linear velocity (in meters per second).
+     * @param acceleration The planned acceleration, used as feed-forward (in meters
+     * per second squared, optional).
      */
-    void set_velocity(float velocity);
+    void set_velocity(float velocity, float acceleration = 0.0);
 
     /**
      * @brief Set the PWM value and operation mode for motor control.
@@ -128,25 +175,101 @@ class MotorDriver {
     uint16_t get_ticks_per_rev();
 
     /**
-     * @brief Update the PID gains used for closed-loop
+     * @brief Change the wheel radius and the number of encoder ticks per
+     * revolution. Should be followed by reset(), the distance travelled so far is
+     * not converted.
+     * @param wheel_radius The radius of the wheel (in meters).
+     * @param ticks_per_rev The number of encoder ticks per revolution.
+     */
+    void set_geometry(float wheel_radius, uint16_t ticks_per_rev);
+
+    /**
+     * @brief Get the number of illegal quadrature transitions seen by the encoder.
+     * @return The error count, 0 without encoder.
+     */
+    uint16_t get_encoder_error_count();
+
+    /**
+     * @brief Update the PID gains used for closed-loop, at all velocities. Replaces
+     * the gain schedule by a single breakpoint.
      *
      * @param pid_gains The PID gains to be overwritten
      */
     void update_motor_pid(pid_gains_t pid_gains);
 
     /**
-     * @brief Retrieve current PID gains
+     * @brief Retrieve current PID gains, interpolated from the gain schedule at the
+     * current velocity setpoint.
      *
      * @return pid_gains_t The current PID gains
      */
     pid_gains_t get_motor_pid();
 
-   private:
+    /**
+     * @brief Set a breakpoint of the gain schedule. Between breakpoints, the gains
+     * are linearly interpolated by the magnitude of the velocity setpoint, and
+     * beyond the first and last ones they are held.
+     *
+     * @param index The index of the breakpoint, at most the current number of
+     * breakpoints to append one.
+     * @param breakpoint The breakpoint. Its velocity must lie strictly between the
+     * ones of its neighbours.
+     * @return True if the breakpoint was set.
+     */
+    bool set_gain_breakpoint(uint8_t index, const GainBreakpoint &breakpoint);
+
+    /**
+     * @brief Replace the gain schedule.
+     *
+     * @param breakpoints The breakpoints, by strictly increasing velocity.
+     * @param size The number of breakpoints (1 to PID_GAIN_SCHEDULE_SIZE).
+     * @return True if the schedule was replaced.
+     */
+    bool set_gain_schedule(const GainBreakpoint *breakpoints, uint8_t size);
+
+    /**
+     * @brief Get the gain schedule.
+     *
+     * @param breakpoints Array of PID_GAIN_SCHEDULE_SIZE breakpoints to fill.
+     * @return The number of breakpoints.
+     */
+    uint8_t get_gain_schedule(GainBreakpoint *breakpoints);
+
+    /**
+     * @brief Update the feed-forward gains added to the PID output.
+     *
+     * @param gains The feed-forward gains.
+     */
+    void set_feedforward_gains(FeedForwardGains gains);
+
+    /**
+     * @brief Retrieve the current feed-forward gains.
+     *
+     * @return The current feed-forward gains.
+     */
+    FeedForwardGains get_feedforward_gains();
+
     /**
      * @brief Send the PWM signal to control the motor (L298N Driver).
      */
     void send_pwm(void);
 
+    /**
+     * @brief Get the compact state of the motor at the last run.
+     * @param sample The state of the motor.
+     */
+    void get_sample(WheelSample &sample);
+
+#if FIXED_POINT_ODOMETRY
+    /**
+     * @brief Get the total distance traveled by the motor, as computed by the last
+     * run.
+     * @return The distance (in meters, Q16).
+     */
+    int32_t get_distance_q16();
+#endif
+
+   private:
     /**
      * @brief Set the direction of motor rotation (CW, CCW, or STOP).
      * @param dir The desired motor direction.
@@ -158,6 +281,19 @@ class MotorDriver {
      */
     void init_pins_(void);
 
+    /**
+     * @brief Compute the feed-forward PWM of the velocity setpoint and planned
+     * acceleration. No static friction is added when the setpoint is 0.
+     * @return The feed-forward PWM.
+     */
+    float compute_feedforward_(void);
+
+    /**
+     * @brief Interpolate the PID gains from the gain schedule at the current
+     * velocity setpoint.
+     */
+    void update_scheduled_gains_(void);
+
     /**
      * @brief Compute the RPM (Revolutions Per Minute) of the motor based on encoder
      * readings.
@@ -165,6 +301,19 @@ class MotorDriver {
      */
     float compute_rpm_(void);
 
+    /**
+     * @brief Update the tick rate estimate from a new encoder sample.
+     * @details Hybrid M/T estimator: at high speed, the ticks are counted over the
+     * control period. At low speed, they are divided by the time between the last
+     * edges of the previous and current samples, which is exact even for a single
+     * tick. Without new edge, the estimate decays as the inverse of the time since
+     * the last edge, and drops to 0 after VELOCITY_TIMEOUT_MS.
+     * @param sample The encoder sample.
+     * @param time The time at which the sample was taken (in us).
+     * @return The number of ticks since the previous sample.
+     */
+    int32_t update_tick_rate_(const EncoderSample &sample, unsigned long time);
+
     /**
      * @brief Compute the angular velocity (radians per second) of the motor.
      * @param rpm The RPM value of the motor.
@@ -194,8 +343,18 @@ class MotorDriver {
     /**
      * @brief Compute motor-related data such as velocity, angular velocity, distance,
      * angle, and RPM.
+     * @param sample The encoder sample.
+     * @param time The time at which the sample was taken (in us).
+     */
+    void compute_motor_data_(const EncoderSample &sample, unsigned long time);
+
+#if FIXED_POINT_ODOMETRY
+    /**
+     * @brief Precompute the fixed-point scale factors from the wheel radius and the
+     * number of ticks per revolution.
      */
-    void compute_motor_data_(void);
+    void init_fixed_point_scales_(void);
+#endif
 
    private:
     // Pins
@@ -205,19 +364,40 @@ class MotorDriver {
 
     // Parameters
     float wheel_radius_;  ///< Radius of the wheel connected to the motor (in meters).
-    uint16_t ticks_per_rev_;  ///< Number of encoder ticks per revolution.
-    bool reverse_;            ///< Flag to reverse motor direction.
+    uint16_t ticks_per_rev_;   ///< Number of encoder ticks per revolution.
+    bool reverse_;             ///< Flag to reverse motor direction.
+    float meters_per_tick_;    ///< Distance travelled per encoder tick (in m).
+    float rpm_per_tick_rate_;  ///< RPM per tick/s (Q4) of tick_rate_.
 
     // Sensor Readings
     MotorData motor_data_;                  ///< Motor-related data.
     int32_t last_encoder_reading_;          ///< Last encoder reading.
-    unsigned long last_data_reading_time_;  ///< Time of the last data reading.
+    unsigned long last_data_reading_time_;  ///< Time of the last data reading (us).
+    unsigned long last_edge_time_;  ///< Time of the last edge of the last reading (us).
+    int32_t tick_rate_;             ///< Estimated tick rate (in ticks/s, Q4).
+    int32_t tick_delta_;            ///< Counts since the previous reading.
 
     MotorDirection motor_dir_;  ///< Current motor direction.
     MotorMode motor_mode_;      ///< Current motor operation mode.
     Encoder *encoder_;          ///< Pointer to the encoder object.
     PID pid_;                   ///< PID controller for closed-loop control.
+    GainBreakpoint gain_schedule_[PID_GAIN_SCHEDULE_SIZE];  ///< Gain schedule.
+    uint8_t gain_schedule_size_;  ///< Number of breakpoints of the schedule.
+    float velocity_setpoint_;   ///< Velocity setpoint (in m/s).
+    float acceleration_;        ///< Planned acceleration (in m/s^2), feed-forward.
+    FeedForwardGains feedforward_;  ///< Feed-forward gains.
     uint8_t pwm_;               ///< PWM value for motor control.
+
+#if FIXED_POINT_ODOMETRY
+    // Fixed-point scale factors, applied to a tick rate in ticks/s (Q4).
+    int32_t velocity_scale_;          ///< m/s per tick/s (Q24).
+    int32_t angular_velocity_scale_;  ///< rad/s per tick/s (Q20).
+    int32_t rpm_scale_;               ///< RPM per tick/s (Q16).
+    int32_t distance_scale_;          ///< Meters per tick (Q28).
+
+    int32_t distance_q16_;       ///< Total traveled distance (in meters, Q16).
+    int32_t distance_residual_;  ///< Fraction of distance_q16_ not yet accounted (Q28).
+#endif
 };
 
 #endif  // MOTOR_DRIVER_HPP
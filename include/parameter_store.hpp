@@ -0,0 +1,84 @@
+#ifndef PARAMETER_STORE_HPP
+#define PARAMETER_STORE_HPP
+
+#include <Arduino.h>
+
+#include "configuration.hpp"
+#include "geometry.hpp"
+#include "motor_driver.hpp"
+
+/**
+ * @brief Version of the Parameters layout. Must be increased whenever Parameters
+ * changes, so that parameters stored with another layout are ignored.
+ */
+#define PARAMETER_STORE_VERSION 1
+
+/**
+ * @struct Parameters
+ * @brief Runtime parameters of the motor controller saved in EEPROM.
+ */
+typedef struct {
+    Geometry geometry;                         ///< Dimensions of the robot.
+    FeedForwardGains feedforward[MAX_WHEELS];  ///< Feed-forward gains of each wheel.
+    uint8_t gain_schedule_size[MAX_WHEELS];    ///< Breakpoints of each gain schedule.
+    GainBreakpoint gain_schedule[MAX_WHEELS][PID_GAIN_SCHEDULE_SIZE];  ///< Schedules.
+} Parameters;
+
+/**
+ * @class ParameterStore
+ * @brief Saves the Parameters in EEPROM, at PARAMETER_STORE_ADDRESS.
+ *
+ * @details The parameters are stored after a header holding a magic number, the
+ * layout version and the size of the parameters, and are followed by a CRC-16 of
+ * the header and parameters. Stored parameters are only used if all of them
+ * match, so that an older layout or an interrupted save falls back to the
+ * compile-time defaults.
+ *
+ * Only the bytes that changed are written, as each EEPROM cell endures about
+ * 100000 writes. A write takes 3.3 ms on the ATmega328, during which the main
+ * loop is blocked.
+ */
+class ParameterStore {
+   public:
+    /**
+     * @brief Load the parameters from EEPROM.
+     * @param params The loaded parameters, unchanged if none are stored.
+     * @return True if valid parameters were loaded.
+     */
+    static bool load(Parameters &params);
+
+    /**
+     * @brief Save the parameters to EEPROM, writing only the bytes that changed.
+     * @param params The parameters to save.
+     * @return The number of bytes written.
+     */
+    static uint16_t save(const Parameters &params);
+
+   private:
+    /**
+     * @brief Read bytes from EEPROM.
+     * @param address The EEPROM address of the first byte.
+     * @param data The buffer to fill.
+     * @param len The number of bytes.
+     */
+    static void read_(uint16_t address, void *data, size_t len);
+
+    /**
+     * @brief Write the bytes that differ from the ones in EEPROM.
+     * @param address The EEPROM address of the first byte.
+     * @param data The bytes to write.
+     * @param len The number of bytes.
+     * @return The number of bytes written.
+     */
+    static uint16_t write_(uint16_t address, const void *data, size_t len);
+
+    /**
+     * @brief Compute the CRC-16 of bytes stored in EEPROM.
+     * @param address The EEPROM address of the first byte.
+     * @param len The number of bytes.
+     * @return The CRC-16.
+     */
+    static uint16_t crc_(uint16_t address, size_t len);
+};
+
+#endif  // !PARAMETER_STORE_HPP
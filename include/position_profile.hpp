@@ -0,0 +1,70 @@
+#ifndef POSITION_PROFILE_HPP
+#define POSITION_PROFILE_HPP
+
+#include <Arduino.h>
+
+/**
+ * @class PositionProfile
+ * @brief Trapezoidal profile of a move from rest to rest: the position, velocity and
+ * acceleration to follow to travel a distance under velocity and acceleration limits.
+ *
+ * @details The profile is stepped once per control tick. The velocity changes by at
+ * most max_acceleration * dt per step, and is capped so that decelerating at
+ * max_acceleration from the next step on stops exactly on the target. Short moves
+ * never reach max_velocity (triangular profile).
+ */
+class PositionProfile {
+   public:
+    /**
+     * @brief Constructor for the PositionProfile class.
+     * @param max_velocity The maximum velocity (in units/s).
+     * @param max_acceleration The maximum acceleration (in units/s^2, 0 for none).
+     */
+    PositionProfile(float max_velocity, float max_acceleration);
+
+    /**
+     * @brief Start a move from position 0, at rest.
+     * @param distance The signed distance to travel.
+     */
+    void start(float distance);
+
+    /**
+     * @brief Advance the profile by one step.
+     * @param dt The duration of the step (in seconds).
+     */
+    void update(float dt);
+
+    /**
+     * @brief Check whether the target is reached, at rest.
+     * @return true if the move is over.
+     */
+    bool is_done(void);
+
+    /**
+     * @brief Get the position to be at.
+     * @return The position, from 0 to the distance of the move.
+     */
+    float get_position(void);
+
+    /**
+     * @brief Get the velocity to move at.
+     * @return The velocity.
+     */
+    float get_velocity(void);
+
+    /**
+     * @brief Get the acceleration of the last step, to be used as feed-forward.
+     * @return The acceleration.
+     */
+    float get_acceleration(void);
+
+   private:
+    float max_velocity_;      ///< Maximum velocity.
+    float max_acceleration_;  ///< Maximum acceleration, 0 for none.
+    float target_;            ///< Distance of the move.
+    float position_;          ///< Current position.
+    float velocity_;          ///< Current velocity.
+    float acceleration_;      ///< Acceleration of the last step.
+};
+
+#endif  // !POSITION_PROFILE_HPP
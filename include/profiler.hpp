@@ -0,0 +1,106 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <Arduino.h>
+
+#include "configuration.hpp"
+
+/**
+ * @enum ProfileStage
+ * @brief Stages of the firmware whose execution time is measured (PROFILING).
+ */
+typedef enum {
+    PROFILE_VELOCITY_LOOP = 0,  ///< Control step: encoders, profiles and PIDs.
+    PROFILE_MOTOR_DATA,         ///< Velocity and distance of a wheel.
+    PROFILE_PID,                ///< PID of a wheel.
+    PROFILE_ODOMETRY,           ///< Pose integration.
+    PROFILE_READ_SERIAL,        ///< Serial input, including the commands parsed.
+    PROFILE_PARSE_CMD,          ///< A text command or binary frame.
+    PROFILE_STAGE_COUNT         ///< Number of stages.
+} ProfileStage;
+
+/**
+ * @struct StageProfile
+ * @brief Execution time of a stage (in us), with the resolution of micros().
+ */
+typedef struct {
+    uint16_t min_duration;   ///< Shortest run.
+    uint16_t max_duration;   ///< Longest run.
+    uint16_t mean_duration;  ///< Mean run.
+    uint16_t count;          ///< Number of runs measured.
+} StageProfile;
+
+/**
+ * @class Profiler
+ * @brief Execution time counters of the firmware stages, and histogram of the main
+ * loop periods.
+ *
+ * @details Only compiled with PROFILING. Stages are measured with PROFILE_SCOPE,
+ * which costs two micros() calls, and main loop passes with PROFILE_LOOP_PASS.
+ * Both expand to nothing otherwise. Bin 0 of the histogram counts the periods below
+ * 16 us, bin i those from 16 * 2^(i - 1) us to twice that, and the last bin all the
+ * longer ones.
+ */
+class Profiler {
+   public:
+    /**
+     * @brief Record a run of a stage. May be called from an interrupt.
+     * @param stage The stage.
+     * @param duration The execution time (in us).
+     */
+    static void record(ProfileStage stage, unsigned long duration);
+
+    /**
+     * @brief Record the period since the previous main loop pass in the histogram.
+     */
+    static void record_loop_pass(void);
+
+    /**
+     * @brief Get the counters since the last read, and reset them.
+     * @param stages The profile of each stage, PROFILE_STAGE_COUNT entries.
+     * @param loop_histogram The main loop period histogram, PROFILER_HISTOGRAM_BINS
+     * entries.
+     */
+    static void read(StageProfile *stages, uint16_t *loop_histogram);
+
+   private:
+    /**
+     * @struct StageCounters
+     * @brief Accumulated execution time of a stage.
+     */
+    typedef struct {
+        uint16_t min_duration;  ///< Shortest run (in us).
+        uint16_t max_duration;  ///< Longest run (in us).
+        uint32_t sum;           ///< Sum of the runs (in us).
+        uint16_t count;         ///< Number of runs.
+    } StageCounters;
+
+    static volatile StageCounters stages_[PROFILE_STAGE_COUNT];  ///< By stage.
+    static uint16_t loop_histogram_[PROFILER_HISTOGRAM_BINS];    ///< Loop periods.
+    static unsigned long last_loop_pass_;  ///< Time of the last loop pass (in us).
+};
+
+/**
+ * @class ProfileScope
+ * @brief Records the execution time of a stage, from its construction to the end
+ * of its scope.
+ */
+class ProfileScope {
+   public:
+    explicit ProfileScope(ProfileStage stage) : stage_(stage), start_(micros()) {}
+    ~ProfileScope() { Profiler::record(stage_, micros() - start_); }
+
+   private:
+    ProfileStage stage_;   ///< The stage measured.
+    unsigned long start_;  ///< Start of the run (in us).
+};
+
+#if PROFILING
+#define PROFILE_SCOPE(stage) ProfileScope profile_scope_(stage)
+#define PROFILE_LOOP_PASS() Profiler::record_loop_pass()
+#else
+#define PROFILE_SCOPE(stage)
+#define PROFILE_LOOP_PASS()
+#endif
+
+#endif  // !PROFILER_HPP
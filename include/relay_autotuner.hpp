@@ -0,0 +1,125 @@
+#ifndef RELAY_AUTOTUNER_HPP
+#define RELAY_AUTOTUNER_HPP
+
+#include <Arduino.h>
+
+#include "pid.hpp"
+
+/**
+ * @enum TuningRule
+ * @brief Rules computing PID gains from the ultimate gain and period.
+ */
+typedef enum {
+    RULE_ZIEGLER_NICHOLS = 0, /**< Classic Ziegler-Nichols, fast with overshoot */
+    RULE_TYREUS_LUYBEN = 1,   /**< Tyreus-Luyben, slower and more robust */
+    RULE_SOME_OVERSHOOT = 2,  /**< Ziegler-Nichols variant with some overshoot */
+    RULE_NO_OVERSHOOT = 3     /**< Ziegler-Nichols variant without overshoot */
+} TuningRule;
+
+/**
+ * @enum AutotuneState
+ * @brief State of a relay auto-tuning experiment.
+ */
+enum class AutotuneState { IDLE, RUNNING, DONE, FAILED };
+
+/**
+ * @struct AutotuneResult
+ * @brief Ultimate gain and period measured by a relay experiment.
+ */
+typedef struct {
+    float ultimate_gain;    ///< Ultimate gain Ku (in PWM per m/s).
+    float ultimate_period;  ///< Ultimate period Pu (in seconds).
+} AutotuneResult;
+
+/**
+ * @class RelayAutotuner
+ * @brief Relay feedback (Astrom-Hagglund) experiment on the velocity of one wheel.
+ *
+ * @details The motor is driven open loop with bias + amplitude PWM while the
+ * velocity is below the setpoint and bias - amplitude above it, with a hysteresis
+ * of AUTOTUNE_NOISE_BAND. This makes the wheel oscillate at its ultimate period
+ * Pu, and the ultimate gain is Ku = 4 * amplitude / (PI * sqrt(a^2 - band^2)),
+ * where a is the amplitude of the velocity oscillation. The bias is corrected on
+ * every cycle so that the relay output is symmetric.
+ *
+ * The first cycles are discarded, then AUTOTUNE_CYCLES cycles are averaged. The
+ * experiment fails after AUTOTUNE_TIMEOUT_MS.
+ */
+class RelayAutotuner {
+   public:
+    /**
+     * @brief Constructor for the RelayAutotuner class.
+     */
+    RelayAutotuner();
+
+    /**
+     * @brief Start an experiment.
+     * @param setpoint The velocity to oscillate around (in m/s).
+     * @param amplitude The relay amplitude (in PWM).
+     * @param bias The PWM expected to hold the setpoint, corrected during the
+     * experiment.
+     * @param time The current time (in us).
+     */
+    void start(float setpoint, uint8_t amplitude, float bias, unsigned long time);
+
+    /**
+     * @brief Stop the experiment and the relay, and return to IDLE.
+     */
+    void cancel(void);
+
+    /**
+     * @brief Advance the experiment with a new velocity measurement.
+     * @param velocity The measured velocity (in m/s).
+     * @param time The time of the measurement (in us).
+     * @return The PWM to apply (-255-255). The relay keeps running once DONE so
+     * that a wheel can wait for the other one, 0 when IDLE or FAILED.
+     */
+    int update(float velocity, unsigned long time);
+
+    /**
+     * @brief Get the state of the experiment.
+     * @return The state.
+     */
+    AutotuneState get_state(void);
+
+    /**
+     * @brief Get the measured ultimate gain and period, valid once DONE.
+     * @param result The result of the experiment.
+     */
+    void get_result(AutotuneResult &result);
+
+    /**
+     * @brief Compute PID gains from the ultimate gain and period.
+     * @param ultimate_gain The ultimate gain.
+     * @param ultimate_period The ultimate period (in seconds).
+     * @param rule The tuning rule.
+     * @return The PID gains.
+     */
+    static pid_gains_t compute_gains(float ultimate_gain,
+                                     float ultimate_period,
+                                     TuningRule rule);
+
+   private:
+    /**
+     * @brief Close the current oscillation cycle at a switch to the high output.
+     * @param time The time of the switch (in us).
+     */
+    void end_cycle_(unsigned long time);
+
+    AutotuneState state_;          ///< State of the experiment.
+    float setpoint_;               ///< Velocity to oscillate around (in m/s).
+    float amplitude_;              ///< Relay amplitude (in PWM).
+    float bias_;                   ///< Relay bias (in PWM).
+    bool output_high_;             ///< Current relay output.
+    unsigned long start_time_;     ///< Start of the experiment (in us).
+    unsigned long cycle_start_;    ///< Start of the current cycle (in us).
+    unsigned long switch_time_;    ///< Last switch to the low output (in us).
+    float cycle_max_;              ///< Highest velocity of the current cycle.
+    float cycle_min_;              ///< Lowest velocity of the current cycle.
+    uint8_t cycles_;               ///< Number of cycles completed.
+    float amplitude_sum_;          ///< Sum of the measured velocity amplitudes.
+    float period_sum_;             ///< Sum of the measured periods (in seconds).
+    AutotuneResult result_;        ///< Measured ultimate gain and period.
+};
+
+#endif  // !RELAY_AUTOTUNER_HPP
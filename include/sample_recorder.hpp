@@ -0,0 +1,103 @@
+#ifndef SAMPLE_RECORDER_HPP
+#define SAMPLE_RECORDER_HPP
+
+#include <Arduino.h>
+
+#include "configuration.hpp"
+#include "motor_driver.hpp"
+
+/**
+ * @enum RecorderTrigger
+ * @brief Event starting a recording.
+ */
+typedef enum {
+    TRIGGER_NOW = 0,       ///< Record from the next control tick.
+    TRIGGER_SETPOINT = 1   ///< Record around the next setpoint change.
+} RecorderTrigger;
+
+/**
+ * @enum RecorderState
+ * @brief State of the sample recorder.
+ */
+typedef enum {
+    RECORDER_IDLE = 0,       ///< Nothing recorded since startup.
+    RECORDER_ARMED = 1,      ///< Recording, waiting for the setpoint to change.
+    RECORDER_RECORDING = 2,  ///< Recording the ticks after the trigger.
+    RECORDER_DONE = 3        ///< Buffer full, ready to be dumped.
+} RecorderState;
+
+/**
+ * @struct RecorderStatus
+ * @brief State and contents of the sample recorder.
+ */
+typedef struct {
+    RecorderState state;    ///< The state.
+    uint8_t count;          ///< Number of records, oldest first.
+    uint8_t trigger_index;  ///< Index of the first record after the trigger.
+    uint8_t divider;        ///< Control ticks per record.
+} RecorderStatus;
+
+/**
+ * @class SampleRecorder
+ * @brief Circular buffer of the wheel states at each control tick, filled by the
+ * control loop and dumped once full, so that fast transients can be seen without
+ * serial output in the control path.
+ *
+ * @details While armed, the buffer is filled continuously, overwriting the oldest
+ * records. Once triggered, RECORDER_PRETRIGGER records before the trigger are
+ * kept and the rest of the buffer is filled, then recording stops.
+ */
+class SampleRecorder {
+   public:
+    SampleRecorder();
+
+    /**
+     * @brief Clear the buffer and start recording.
+     * @param trigger The event starting the recording.
+     * @param divider Control ticks per record, at least 1.
+     */
+    void arm(RecorderTrigger trigger, uint8_t divider);
+
+    /**
+     * @brief Signal a setpoint change, triggering an armed recording.
+     */
+    void trigger(void);
+
+    /**
+     * @brief Count a control tick.
+     * @return True if the tick must be recorded.
+     */
+    bool tick(void);
+
+    /**
+     * @brief Record the wheels at a control tick.
+     * @param wheels The state of each wheel, MAX_WHEELS entries.
+     */
+    void record(const WheelSample *wheels);
+
+    /**
+     * @brief Get the state and contents of the recorder.
+     * @param status The status.
+     */
+    void get_status(RecorderStatus &status);
+
+    /**
+     * @brief Get a record.
+     * @param index The index of the record, 0 being the oldest.
+     * @param wheels The state of each wheel, MAX_WHEELS entries.
+     * @return True if the record exists.
+     */
+    bool get_record(uint8_t index, WheelSample *wheels);
+
+   private:
+    WheelSample records_[RECORDER_SIZE][MAX_WHEELS];  ///< Circular buffer.
+    RecorderState state_;    ///< The state.
+    uint8_t head_;           ///< Index of the next record written.
+    uint8_t count_;          ///< Number of records.
+    uint8_t remaining_;      ///< Records left to write after the trigger.
+    uint8_t trigger_index_;  ///< Index of the first record after the trigger.
+    uint8_t divider_;        ///< Control ticks per record.
+    uint8_t ticks_;          ///< Control ticks since the last record.
+};
+
+#endif  // !SAMPLE_RECORDER_HPP
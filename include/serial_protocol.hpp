@@ -3,7 +3,13 @@
 
 #include <Arduino.h>
 
+#include "binary_protocol.hpp"
+#include "line_reader.hpp"
 #include "motor_controller.hpp"
+#include "parameter_store.hpp"
+#include "profiler.hpp"
+#include "task_scheduler.hpp"
+#include "tx_buffer.hpp"
 
 // TODO: Add flags to update PID values
 /**
@@ -11,15 +17,41 @@
  * @brief Enumeration of recognized serial command flags.
  */
 typedef enum {
-    FLAG_CLOSE = 'c',        /**< Flag for closed-loop mode */
-    FLAG_OPEN = 'o',         /**< Flag for open-loop mode */
-    FLAG_POSE = 'q',         /**< Flag to request robot's pose (odometry) */
-    FLAG_MOTOR_STATUS = 'm', /**< Flag to request motor status */
-    FLAG_RESET = 'r',        /**< Flag to reset the robot's pose*/
-    FLAG_PID_GAINS = 'p',    /**< Flag to update PID gains */
-    FLAG_PID_GET = 'g'       /**< Flag to request PID gains */
+    FLAG_CLOSE = 'c',             /**< Flag for closed-loop mode */
+    FLAG_OPEN = 'o',              /**< Flag for open-loop mode */
+    FLAG_POSE = 'q',              /**< Flag to request robot's pose (odometry) */
+    FLAG_MOTOR_STATUS = 'm',      /**< Flag to request motor status */
+    FLAG_RESET = 'r',             /**< Flag to reset the robot's pose*/
+    FLAG_PID_GAINS = 'p',         /**< Flag to update PID gains */
+    FLAG_PID_GET = 'g',           /**< Flag to request PID gains */
+    FLAG_BINARY = 'b',            /**< Flag to switch to the binary protocol */
+    FLAG_STATS = 'e',             /**< Flag to request the error counters */
+    FLAG_TELEMETRY = 's',         /**< Flag to set the telemetry streaming rate */
+    FLAG_LOOP_TIMING = 'j',       /**< Flag to request the control loop timing */
+    FLAG_FEEDFORWARD = 'f',       /**< Flag to update feed-forward gains */
+    FLAG_FEEDFORWARD_GET = 'k',   /**< Flag to request feed-forward gains */
+    FLAG_AUTOTUNE = 'a',          /**< Flag to start the PID auto-tuner */
+    FLAG_AUTOTUNE_GET = 'u',      /**< Flag to request the auto-tuner status */
+    FLAG_GAIN_SCHEDULE = 'h',     /**< Flag to set a breakpoint of a gain schedule */
+    FLAG_GAIN_SCHEDULE_GET = 'n', /**< Flag to request the gain schedule of a wheel */
+    FLAG_GEOMETRY = 'd',          /**< Flag to set the dimensions of the robot */
+    FLAG_GEOMETRY_GET = 'i',      /**< Flag to request the dimensions of the robot */
+    FLAG_SAVE = 'w',              /**< Flag to save the parameters in EEPROM */
+    FLAG_TASK_STATS = 'l',        /**< Flag to request the task statistics */
+    FLAG_PROFILE = 'x',           /**< Flag to request the profile (PROFILING) */
+    FLAG_RECORD = 'y',            /**< Flag to start recording samples */
+    FLAG_RECORD_DUMP = 'z',       /**< Flag to dump the recorded samples */
+    FLAG_CLOSE_REPORT = 'v',      /**< Flag for closed-loop mode, returning the state */
+    FLAG_MOVE = 't'               /**< Flag to start a position move */
 } Flags;
 
+/**
+ * @enum ProtocolMode
+ * @brief Enumerates the possible serial protocol modes: text commands or binary
+ * COBS frames.
+ */
+enum class ProtocolMode { TEXT, BINARY };
+
 /**
  * @class SerialProtocol
  * @brief Class responsible for parsing serial commands and interacting with
@@ -34,17 +66,52 @@ class SerialProtocol {
     SerialProtocol(MotorController* motorCtrl);
 
     /**
-     * @brief Read serial input and process the commands.
+     * @brief Hand the pending replies and events to the UART, then read serial
+     * input and process the commands.
+     * @details Never blocks: a command is only processed once the replies of the
+     * previous one are handed to the UART, the next ones wait in the receive buffer.
      */
     void read_serial();
 
+    /**
+     * @brief Send a telemetry sample (pose and motor status) if streaming is enabled
+     * and enough calls have elapsed since the last one.
+     * @details Must be called TELEMETRY_FREQUENCY times per second, by the telemetry
+     * task of the scheduler.
+     */
+    void stream_telemetry();
+
    private:
     /**
-     * @brief Parses a received command string.
-     * @param cmd String containing the received command.
+     * @brief Parses a received command line, in place.
+     * @param cmd Null-terminated string containing the received command.
      * @return Integer status code representing the outcome of the parsing.
      */
-    int parse_cmd_(const String& cmd);
+    int parse_cmd_(const char* cmd);
+
+    /**
+     * @struct Setpoint
+     * @brief A velocity or open-loop command.
+     */
+    typedef struct {
+        bool open_loop;     ///< Open-loop command, velocity command otherwise.
+        CmdVel cmd_vel;     ///< The velocity command.
+        uint8_t left_pwm;   ///< The PWM of the left wheels (open-loop).
+        uint8_t right_pwm;  ///< The PWM of the right wheels (open-loop).
+    } Setpoint;
+
+    /**
+     * @brief Apply a velocity or open-loop command, or keep it until the end of the
+     * main loop pass (SERIAL_COALESCE_SETPOINTS), superseding the kept one.
+     * @param setpoint The command.
+     * @return The status code to acknowledge the command with.
+     */
+    int submit_setpoint_(const Setpoint& setpoint);
+
+    /**
+     * @brief Apply the kept velocity or open-loop command, if any.
+     */
+    void apply_setpoint_(void);
 
     /**
      * @brief Sends an acknowledgment message over serial.
@@ -52,8 +119,95 @@ class SerialProtocol {
      */
     void send_ack(int code);
 
+    /**
+     * @brief Set the telemetry streaming rate.
+     * @param rate The sampling rate (in Hz), 0 to stop streaming. Rates above
+     * TELEMETRY_FREQUENCY stream on every run of the telemetry task.
+     */
+    void set_telemetry_rate_(uint8_t rate);
+
+    /**
+     * @brief Accumulate a received character of a text command, and process the
+     * command once its line is complete.
+     * @param c The received character.
+     */
+    void read_text_(char c);
+
+    /**
+     * @brief Print the records of the sample recorder not printed yet, as long as
+     * they fit in the reply buffer.
+     */
+    void dump_records_(void);
+
+    /**
+     * @brief Send the outcome of the last position move once it has ended, when
+     * no other reply is pending.
+     */
+    void report_move_(void);
+
+    /**
+     * @brief Print the state of the robot: timestamp and pose, then the data of each
+     * motor, separated by commas.
+     * @param timestamp The time of the last control tick (in milliseconds).
+     * @param pose The pose.
+     * @param motors The data of each motor.
+     * @param wheel_count The number of motors.
+     */
+    void print_state_(unsigned long timestamp,
+                      const Pose& pose,
+                      const MotorData* motors,
+                      uint8_t wheel_count);
+
+    /**
+     * @brief Print the data of a motor, separated by spaces.
+     * @param motor_data The data of the motor.
+     */
+    void print_motor_data_(const MotorData& motor_data);
+
+    /**
+     * @brief Accumulate a received byte of a binary frame, and process the frame
+     * once its delimiter is received.
+     * @param byte The received byte.
+     */
+    void read_binary_(uint8_t byte);
+
+    /**
+     * @brief Parses a received binary frame, in place.
+     * @param frame The decoded frame (message id and payload, without CRC).
+     * @param len The length of the frame.
+     * @return Integer status code representing the outcome of the parsing.
+     */
+    int parse_frame_(const uint8_t* frame, size_t len);
+
+    /**
+     * @brief Encode and send a binary frame.
+     * @param id The message id.
+     * @param payload The message payload.
+     * @param len The length of the payload.
+     */
+    void send_frame_(uint8_t id, const void* payload, size_t len);
+
     MotorController*
         motorController_; /**< Pointer to the MotorController for motor operations. */
+    ProtocolMode mode_;   /**< Protocol currently used. */
+    LineReader line_reader_; /**< Assembles the text commands. */
+
+    uint8_t rx_frame_[BINARY_FRAME_BUFFER_SIZE(
+        BINARY_MAX_RX_PAYLOAD_SIZE)]; /**< Encoded binary frame being received. */
+    uint8_t rx_frame_len_;            /**< Number of bytes in rx_frame_. */
+    bool rx_frame_overflow_; /**< Frame too long, dropped until its delimiter. */
+    uint16_t invalid_frames_; /**< Number of frames with a bad CRC or encoding. */
+
+    Setpoint setpoint_;              /**< Command kept until the end of the pass. */
+    bool setpoint_pending_;          /**< setpoint_ is waiting to be applied. */
+    uint16_t superseded_setpoints_;  /**< Number of commands never applied. */
+
+    TxBuffer tx_;         /**< Replies waiting for the UART. */
+    int16_t dump_index_;  /**< Next record printed by `z`, -1 if none. */
+
+    uint8_t telemetry_divider_;      /**< Stream every Nth call, 0 if off. */
+    uint8_t telemetry_calls_;        /**< Calls since the last sample. */
+    uint32_t telemetry_seq_;         /**< Sequence number of the next sample. */
 };
 
 #endif  // !SERIAL_PROTOCOL_HPP
@@ -0,0 +1,86 @@
+#ifndef TASK_SCHEDULER_HPP
+#define TASK_SCHEDULER_HPP
+
+#include <Arduino.h>
+
+#include "configuration.hpp"
+
+/**
+ * @brief Function run by a task.
+ */
+typedef void (*TaskFunction)(void);
+
+/**
+ * @struct TaskStats
+ * @brief Execution statistics of a task since startup.
+ */
+typedef struct {
+    uint32_t runs;             ///< Number of runs.
+    uint16_t overruns;         ///< Releases skipped, the task started a period late.
+    uint16_t deadline_misses;  ///< Runs completed after the next release.
+    uint16_t max_duration;     ///< Longest run (in us).
+} TaskStats;
+
+/**
+ * @class TaskScheduler
+ * @brief Cooperative scheduler running periodic tasks from the main loop.
+ *
+ * @details Each task is released every period, shifted by its phase offset so that
+ * tasks of the same rate can be spread over different loop passes. On each call of
+ * run(), the released tasks are run to completion in the order they were added,
+ * which sets their priority. A task started a full period or more after its
+ * release skips the missed releases, counted as overruns, instead of running
+ * several times in a row. A run completing after the next release is counted as a
+ * deadline miss.
+ */
+class TaskScheduler {
+   public:
+    /**
+     * @brief Add a task, released for the first time after its offset.
+     * @param function The function to run.
+     * @param period_us The period of the task (in us).
+     * @param offset_us The phase offset of the task (in us).
+     * @return The index of the task, or -1 if SCHEDULER_MAX_TASKS are already
+     * added or the period is 0.
+     */
+    static int8_t add_task(TaskFunction function,
+                           uint32_t period_us,
+                           uint32_t offset_us = 0);
+
+    /**
+     * @brief Run the released tasks. Must be called on every iteration of the main
+     * loop.
+     */
+    static void run(void);
+
+    /**
+     * @brief Get the number of tasks.
+     * @return The number of tasks.
+     */
+    static uint8_t get_task_count(void);
+
+    /**
+     * @brief Get the execution statistics of a task.
+     * @param task The index of the task.
+     * @param stats The statistics.
+     * @return True if the task exists.
+     */
+    static bool get_stats(uint8_t task, TaskStats &stats);
+
+   private:
+    /**
+     * @struct Task
+     * @brief A periodic task and its statistics.
+     */
+    typedef struct {
+        TaskFunction function;       ///< The function to run.
+        uint32_t period;             ///< Period (in us).
+        unsigned long next_release;  ///< Time of the next release (in us, micros()).
+        TaskStats stats;             ///< Execution statistics.
+    } Task;
+
+    static Task tasks_[SCHEDULER_MAX_TASKS];  ///< The tasks, by priority.
+    static uint8_t task_count_;               ///< The number of tasks.
+};
+
+#endif  // !TASK_SCHEDULER_HPP
@@ -0,0 +1,115 @@
+#ifndef TX_BUFFER_HPP
+#define TX_BUFFER_HPP
+
+#include <Arduino.h>
+
+#include "configuration.hpp"
+
+/**
+ * @class TxBuffer
+ * @brief Serial replies formatted in a static buffer, and handed to the UART only
+ * as fast as its transmit buffer accepts them, so that writing never blocks.
+ *
+ * @details The print methods format like the Arduino Print class: integers in
+ * decimal, floats with a fixed number of decimals (2 by default). A reply is
+ * written between begin_reply() and end_reply(): if it does not fit in the free
+ * space, it is removed as a whole, and must be deferred or reported by the caller.
+ */
+class TxBuffer {
+   public:
+    TxBuffer();
+
+    /**
+     * @brief Start a reply, discarding the overflow of the previous one.
+     */
+    void begin_reply(void);
+
+    /**
+     * @brief End a reply.
+     * @param headroom The space to leave free after the reply, to keep room for
+     * replies with a higher priority.
+     * @return True if the reply fits, false if it was removed.
+     */
+    bool end_reply(uint16_t headroom = 0);
+
+    void print(const char *str);
+    void print(char c);
+    void print(int value);
+    void print(unsigned int value);
+    void print(long value);
+    void print(unsigned long value);
+
+    /**
+     * @brief Format a float with a fixed number of decimals, rounded to nearest.
+     * @param value The value, "ovf" if its magnitude exceeds 4294967295 / 10^decimals.
+     * @param decimals The number of decimals, at most 9.
+     */
+    void print(double value, uint8_t decimals = 2);
+
+    /**
+     * @brief End the line, with "\r\n" like the Arduino Print class.
+     */
+    void println(void);
+
+    template <typename T>
+    void println(T value) {
+        print(value);
+        println();
+    }
+
+    template <typename T>
+    void println(T value, uint8_t decimals) {
+        print(value, decimals);
+        println();
+    }
+
+    /**
+     * @brief Reserve raw bytes at the end of the reply, e.g. to encode a frame in
+     * place.
+     * @param len The number of bytes.
+     * @return The bytes, or nullptr if they do not fit (the reply overflows).
+     */
+    uint8_t *reserve(size_t len);
+
+    /**
+     * @brief Keep the first bytes of the last reservation, see reserve().
+     * @param len The number of bytes used.
+     */
+    void commit(size_t len);
+
+    /**
+     * @brief Check whether all the replies were handed to the UART.
+     * @return True if the buffer is empty.
+     */
+    bool is_empty(void);
+
+    /**
+     * @brief Get the space left for the next replies.
+     * @return The number of bytes that are free or already handed to the UART.
+     */
+    uint16_t get_free_space(void);
+
+    /**
+     * @brief Hand as many bytes to the UART as it accepts without blocking.
+     */
+    void flush(void);
+
+   private:
+    /**
+     * @brief Append bytes to the reply, or mark it as overflowing.
+     */
+    void append_(const char *data, size_t len);
+
+    /**
+     * @brief Format an unsigned integer, with at least min_digits digits.
+     */
+    void print_unsigned_(unsigned long value, uint8_t min_digits = 1);
+
+    uint8_t buffer_[SERIAL_REPLY_BUFFER_SIZE];  ///< Replies not sent yet.
+    uint16_t len_;          ///< Number of bytes in buffer_.
+    uint16_t sent_;         ///< Number of bytes of buffer_ handed to the UART.
+    uint16_t reply_start_;  ///< Start of the reply being written.
+    bool overflow_;         ///< The reply being written does not fit.
+};
+
+#endif  // !TX_BUFFER_HPP
@@ -75,6 +75,14 @@ inline void bound(uint8_t &value, uint8_t min, uint8_t max) {
  */
 inline unsigned long hz_to_ms(uint8_t hz) { return 1000 / hz; }
 
+/**
+ * @brief Transform Hz to microseconds.
+ * @param hz The frequency in Hz.
+ * @return The period in microseconds.
+ *
+ */
+inline unsigned long hz_to_us(uint16_t hz) { return 1000000UL / hz; }
+
 /**
  * @brief Transform Hz to secons.
  * @param hz The frequency in Hz.
@@ -83,4 +91,17 @@ inline unsigned long hz_to_ms(uint8_t hz) { return 1000 / hz; }
  */
 inline unsigned long hz_to_s(uint8_t hz) { return 1 / hz; }
 
+/**
+ * @brief Check that a value is neither NaN nor infinite.
+ * @param value The value to check.
+ * @return True if the value is finite.
+ */
+inline bool is_finite(float value) { return !isnan(value) && !isinf(value); }
+
+/**
+ * @brief Keep the compiler from moving memory accesses across this point, to order
+ * plain data against the volatile flags shared with an interrupt.
+ */
+inline void compiler_barrier(void) { asm volatile("" ::: "memory"); }
+
 #endif  // !UTILS_HPP
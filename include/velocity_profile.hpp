@@ -0,0 +1,75 @@
+#ifndef VELOCITY_PROFILE_HPP
+#define VELOCITY_PROFILE_HPP
+
+#include <Arduino.h>
+
+/**
+ * @class VelocityProfile
+ * @brief Ramps a velocity towards a target under acceleration and jerk limits.
+ *
+ * @details The profile is stepped once per control tick. The acceleration changes by
+ * at most max_jerk * dt per step and is brought back to 0 in time to reach the
+ * target without overshoot. A limit of 0 disables it.
+ */
+class VelocityProfile {
+   public:
+    /**
+     * @brief Constructor for the VelocityProfile class.
+     * @param max_acceleration The maximum acceleration (in units/s^2, 0 for none).
+     * @param max_jerk The maximum jerk (in units/s^3, 0 for none).
+     */
+    VelocityProfile(float max_acceleration, float max_jerk);
+
+    /**
+     * @brief Set the acceleration and jerk limits.
+     * @param max_acceleration The maximum acceleration (in units/s^2, 0 for none).
+     * @param max_jerk The maximum jerk (in units/s^3, 0 for none).
+     */
+    void set_limits(float max_acceleration, float max_jerk);
+
+    /**
+     * @brief Set the velocity to ramp to.
+     * @param target The target velocity, ignored if not finite.
+     */
+    void set_target(float target);
+
+    /**
+     * @brief Jump to a velocity, at rest.
+     * @param velocity The velocity, also used as target.
+     */
+    void reset(float velocity = 0.0);
+
+    /**
+     * @brief Advance the profile by one step.
+     * @param dt The duration of the step (in seconds).
+     * @return The new velocity.
+     */
+    float update(float dt);
+
+    /**
+     * @brief Check whether the target is reached with no acceleration left.
+     * @return true if the profile is settled.
+     */
+    bool is_settled(void);
+
+    /**
+     * @brief Get the current velocity of the profile.
+     * @return The velocity.
+     */
+    float get_velocity(void);
+
+    /**
+     * @brief Get the current acceleration of the profile, to be used as feed-forward.
+     * @return The acceleration.
+     */
+    float get_acceleration(void);
+
+   private:
+    float max_acceleration_;  ///< Maximum acceleration, 0 for none.
+    float max_jerk_;          ///< Maximum jerk, 0 for none.
+    float target_;            ///< Target velocity.
+    float velocity_;          ///< Current velocity.
+    float acceleration_;      ///< Current acceleration.
+};
+
+#endif  // !VELOCITY_PROFILE_HPP
@@ -0,0 +1,178 @@
+/**
+ * @file main.cpp
+ * @brief Host micro-benchmarks of the control loop building blocks.
+ *
+ * Usage: program
+ *
+ * Reports the accuracy and host cost of the sine/cosine implementations used by
+ * the odometry, against libm, and the cost of a control loop update as the number
+ * of wheels grows (built with MAX_WHEELS=8). Host timings only give relative
+ * costs, the AVR has no FPU and its libm is comparatively much slower. It also
+ * checks that the sample recorder keeps the sign of the PWM, and fails otherwise.
+ */
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <vector>
+
+#include "encoder.hpp"
+#include "fast_trig.hpp"
+#include "fixed_point.hpp"
+#include "motor_controller.hpp"
+#include "motor_driver.hpp"
+#include "native_hal.hpp"
+
+namespace {
+
+const int SAMPLES = 1000000;
+const int CONTROL_UPDATES = 200000;
+const uint32_t CONTROL_PERIOD_US = 1000000 / MOTOR_RUN_FREQUENCY;
+volatile float float_sink;
+volatile int32_t fixed_sink;
+
+using bench_clock = std::chrono::steady_clock;
+
+double elapsed_ns(bench_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+}
+
+float sample_angle(int i) { return -PI + 2 * PI * i / SAMPLES; }
+
+void report(const char *name, double max_error, double ns) {
+    printf("%-28s max error %.2e, %6.2f ns per sin+cos\n", name, max_error, ns);
+}
+
+void bench_trig(void) {
+    double max_error = 0;
+    for (int i = 0; i < SAMPLES; i++) {
+        float angle = sample_angle(i);
+        max_error = fmax(max_error, fabs(sinf(angle) - sin(double(angle))));
+        max_error = fmax(max_error, fabs(cosf(angle) - cos(double(angle))));
+    }
+    auto start = bench_clock::now();
+    for (int i = 0; i < SAMPLES; i++) {
+        float angle = sample_angle(i);
+        float_sink = sinf(angle) + cosf(angle);
+    }
+    report("libm sinf/cosf", max_error, elapsed_ns(start) / SAMPLES);
+
+    max_error = 0;
+    for (int i = 0; i < SAMPLES; i++) {
+        float angle = sample_angle(i);
+        float s, c;
+        fast_sincos(angle, s, c);
+        max_error = fmax(max_error, fabs(s - sin(double(angle))));
+        max_error = fmax(max_error, fabs(c - cos(double(angle))));
+    }
+    start = bench_clock::now();
+    for (int i = 0; i < SAMPLES; i++) {
+        float s, c;
+        fast_sincos(sample_angle(i), s, c);
+        float_sink = s + c;
+    }
+    report("fast_sincos (table)", max_error, elapsed_ns(start) / SAMPLES);
+
+    max_error = 0;
+    for (int i = 0; i < SAMPLES; i++) {
+        uint32_t angle = uint32_t(i) * (0xFFFFFFFFUL / SAMPLES);
+        double rad = binary_angle_to_rad(angle);
+        max_error = fmax(max_error, fabs(fixed_sin(angle) / 32768.0 - sin(rad)));
+        max_error = fmax(max_error, fabs(fixed_cos(angle) / 32768.0 - cos(rad)));
+    }
+    start = bench_clock::now();
+    for (int i = 0; i < SAMPLES; i++) {
+        uint32_t angle = uint32_t(i) * (0xFFFFFFFFUL / SAMPLES);
+        fixed_sink = fixed_sin(angle) + fixed_cos(angle);
+    }
+    report("fixed_sin/fixed_cos (poly)", max_error, elapsed_ns(start) / SAMPLES);
+}
+
+void bench_control_loop(uint8_t wheel_count) {
+    // All the motors share their output pins, only the encoders need their own.
+    const uint8_t PIN_EN = 28, PIN_IN1 = 29, PIN_IN2 = 30;
+    std::vector<Encoder> encoders;
+    std::vector<MotorDriver> motors;
+    std::vector<WheelSide> sides;
+    encoders.reserve(wheel_count);
+    motors.reserve(wheel_count);
+    for (uint8_t i = 0; i < wheel_count; i++) {
+        encoders.emplace_back(2 * i, 2 * i + 1);
+        motors.emplace_back(PIN_EN,
+                            PIN_IN1,
+                            PIN_IN2,
+                            &encoders[i],
+                            DEFAULT_GEOMETRY.wheel_radius,
+                            DEFAULT_GEOMETRY.counts_per_rev());
+        sides.push_back(i < (wheel_count + 1) / 2 ? SIDE_LEFT : SIDE_RIGHT);
+    }
+    MotorController controller(motors.data(), sides.data(), wheel_count);
+    controller.set_cmd_vel({0.3, 1.0});
+
+    // One encoder edge per wheel and update, so that the odometry integrates.
+    auto start = bench_clock::now();
+    for (int i = 0; i < CONTROL_UPDATES; i++) {
+        native_hal::advance_micros(CONTROL_PERIOD_US);
+        for (auto &encoder : encoders) {
+            encoder.tick_isr();
+        }
+        controller.control_isr();
+        controller.update_odometry();
+    }
+    double ns = elapsed_ns(start) / CONTROL_UPDATES;
+    printf("control loop, %u wheels         %8.1f ns per update, %6.1f ns per wheel\n",
+           wheel_count,
+           ns,
+           ns / wheel_count);
+}
+
+bool check_recorder_sign(void) {
+    // Driving backwards with the wheels held still, the PWM only grows negative.
+    Encoder left_encoder(0, 1), right_encoder(2, 3);
+    MotorDriver motors[2] = {
+        MotorDriver(28,
+                    29,
+                    30,
+                    &left_encoder,
+                    DEFAULT_GEOMETRY.wheel_radius,
+                    DEFAULT_GEOMETRY.counts_per_rev()),
+        MotorDriver(31,
+                    32,
+                    33,
+                    &right_encoder,
+                    DEFAULT_GEOMETRY.wheel_radius,
+                    DEFAULT_GEOMETRY.counts_per_rev())};
+    WheelSide sides[2] = {SIDE_LEFT, SIDE_RIGHT};
+    MotorController controller(motors, sides, 2);
+    controller.start_recording(TRIGGER_NOW, 1);
+    controller.set_cmd_vel({-0.3, 0.0});
+    for (int i = 0; i < RECORDER_SIZE; i++) {
+        native_hal::advance_micros(CONTROL_PERIOD_US);
+        controller.control_isr();
+    }
+
+    int negative = 0, positive = 0;
+    WheelSample wheels[MAX_WHEELS];
+    for (uint8_t i = 0; controller.get_record(i, wheels); i++) {
+        for (uint8_t j = 0; j < 2; j++) {
+            if (wheels[j].pwm < 0) negative++;
+            if (wheels[j].pwm > 0) positive++;
+        }
+    }
+    bool ok = negative > 0 && positive == 0;
+    printf("recorder pwm sign, reversing    %s (%d negative, %d positive)\n",
+           ok ? "ok" : "FAILED",
+           negative,
+           positive);
+    return ok;
+}
+
+}  // namespace
+
+int main(void) {
+    bench_trig();
+    for (uint8_t wheel_count = 2; wheel_count <= MAX_WHEELS; wheel_count += 2) {
+        bench_control_loop(wheel_count);
+    }
+    return check_recorder_sign() ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+/**
+ * @file Arduino.h
+ * @brief Minimal host-side replacement for the Arduino core, used by the
+ * `native` PlatformIO environment.
+ *
+ * @details Only the subset of the Arduino API used by this firmware is provided.
+ * Time is simulated: `millis()` and `micros()` only advance when the simulation
+ * calls native_hal::advance_micros(). Pin writes are recorded so that the
+ * simulated motor plant can read them back, and interrupts are fired
+ * synchronously when the plant changes an input pin.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define DEC 10
+#define HEX 16
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define NOT_AN_INTERRUPT -1
+
+// Flash and RAM share the same address space on the host.
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+
+// -----------------------------------------------------------------------------
+// ----------------------------------| Time |-----------------------------------
+// -----------------------------------------------------------------------------
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// -----------------------------------------------------------------------------
+// -------------------------------| Digital I/O |-------------------------------
+// -----------------------------------------------------------------------------
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+int analogRead(uint8_t pin);
+
+// -----------------------------------------------------------------------------
+// -------------------------------| Interrupts |--------------------------------
+// -----------------------------------------------------------------------------
+
+// Every pin can raise an interrupt on the host, the interrupt number is the pin.
+#define digitalPinToInterrupt(p) ((int)(p))
+
+void attachInterrupt(int interrupt, void (*isr)(void), int mode);
+void detachInterrupt(int interrupt);
+
+// Interrupts are fired synchronously from the simulation thread, so there is
+// nothing to mask.
+inline void noInterrupts(void) {}
+inline void interrupts(void) {}
+
+// -----------------------------------------------------------------------------
+// ---------------------------------| String |----------------------------------
+// -----------------------------------------------------------------------------
+
+/**
+ * @class String
+ * @brief Subset of the Arduino String class, backed by std::string.
+ */
+class String {
+   public:
+    String(const char *str = "") : str_(str) {}
+    String(const std::string &str) : str_(str) {}
+    String(char c) : str_(1, c) {}
+    String(int value) : str_(std::to_string(value)) {}
+    String(unsigned int value) : str_(std::to_string(value)) {}
+    String(long value) : str_(std::to_string(value)) {}
+    String(unsigned long value) : str_(std::to_string(value)) {}
+    String(float value, unsigned char decimals = 2);
+    String(double value, unsigned char decimals = 2);
+
+    unsigned int length(void) const { return str_.size(); }
+    char charAt(unsigned int index) const {
+        return index < str_.size() ? str_[index] : 0;
+    }
+    const char *c_str(void) const { return str_.c_str(); }
+
+    String &operator+=(const String &rhs) {
+        str_ += rhs.str_;
+        return *this;
+    }
+    String &operator+=(const char *rhs) {
+        str_ += rhs;
+        return *this;
+    }
+    String &operator+=(char rhs) {
+        str_ += rhs;
+        return *this;
+    }
+    bool operator==(const char *rhs) const { return str_ == rhs; }
+
+    friend String operator+(const String &lhs, const String &rhs) {
+        return String(lhs.str_ + rhs.str_);
+    }
+    friend String operator+(const String &lhs, const char *rhs) {
+        return String(lhs.str_ + rhs);
+    }
+
+   private:
+    std::string str_;
+};
+
+// -----------------------------------------------------------------------------
+// ---------------------------------| Serial |----------------------------------
+// -----------------------------------------------------------------------------
+
+/**
+ * @class HardwareSerial
+ * @brief Host-side serial port. RX bytes are injected by the simulation and TX
+ * bytes are captured, see native_hal.hpp.
+ */
+class HardwareSerial {
+   public:
+    void begin(unsigned long baud);
+    void end(void) {}
+    int available(void);
+    int availableForWrite(void);
+    int peek(void);
+    int read(void);
+    void flush(void) {}
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+
+    size_t print(const char *str) { return write(str); }
+    size_t print(const String &str) { return write(str.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println(void) { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value) {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(const T &value, int format) {
+        size_t n = print(value, format);
+        return n + println();
+    }
+
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif  // !NATIVE_ARDUINO_H
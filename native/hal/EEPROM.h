@@ -0,0 +1,29 @@
+#ifndef NATIVE_EEPROM_H
+#define NATIVE_EEPROM_H
+
+/**
+ * @file EEPROM.h
+ * @brief Host-side replacement for the Arduino EEPROM library, backed by RAM.
+ *
+ * @details The memory has the size of the ATmega328 EEPROM and starts erased
+ * (0xFF). It survives native_hal::reset(), like the real EEPROM survives a reset
+ * of the board.
+ */
+
+#include <Arduino.h>
+
+/**
+ * @class EEPROMClass
+ * @brief Subset of the Arduino EEPROM class.
+ */
+class EEPROMClass {
+   public:
+    uint8_t read(int idx);
+    void write(int idx, uint8_t val);
+    void update(int idx, uint8_t val);
+    uint16_t length(void);
+};
+
+extern EEPROMClass EEPROM;
+
+#endif  // !NATIVE_EEPROM_H
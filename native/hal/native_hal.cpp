@@ -0,0 +1,264 @@
+#include "native_hal.hpp"
+
+#include <EEPROM.h>
+
+#include <deque>
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+namespace {
+
+struct PinState {
+    uint8_t mode = INPUT;
+    int digital = LOW;
+    int analog = 0;
+    uint32_t analog_writes = 0;
+    void (*isr)(void) = nullptr;
+    int isr_mode = 0;
+};
+
+uint64_t now_us = 0;
+uint32_t timer_period_us = 0;
+uint64_t timer_deadline_us = 0;
+void (*timer_callback)(void) = nullptr;
+PinState pins[native_hal::NUM_PINS];
+std::deque<uint8_t> serial_rx;
+std::string serial_tx;
+uint32_t eeprom_writes = 0;
+
+// The EEPROM of a new board is erased.
+struct Eeprom {
+    uint8_t bytes[native_hal::EEPROM_SIZE];
+    Eeprom() { memset(bytes, 0xFF, sizeof(bytes)); }
+} eeprom;
+
+PinState *get_pin(uint8_t pin) {
+    if (pin >= native_hal::NUM_PINS) {
+        return nullptr;
+    }
+    return &pins[pin];
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------------
+// ------------------------------| Arduino API |--------------------------------
+// -----------------------------------------------------------------------------
+
+unsigned long millis(void) { return now_us / 1000; }
+
+unsigned long micros(void) { return now_us; }
+
+void delay(unsigned long ms) { native_hal::advance_micros(ms * 1000); }
+
+void delayMicroseconds(unsigned int us) { native_hal::advance_micros(us); }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    PinState *state = get_pin(pin);
+    if (state == nullptr) return;
+    state->mode = mode;
+    if (mode == INPUT_PULLUP) state->digital = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    PinState *state = get_pin(pin);
+    if (state == nullptr) return;
+    state->digital = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+    PinState *state = get_pin(pin);
+    return state == nullptr ? LOW : state->digital;
+}
+
+void analogWrite(uint8_t pin, int val) {
+    PinState *state = get_pin(pin);
+    if (state == nullptr) return;
+    state->analog = val;
+    state->analog_writes++;
+}
+
+int analogRead(uint8_t pin) {
+    PinState *state = get_pin(pin);
+    return state == nullptr ? 0 : state->analog;
+}
+
+void attachInterrupt(int interrupt, void (*isr)(void), int mode) {
+    PinState *state = get_pin(interrupt);
+    if (state == nullptr) return;
+    state->isr = isr;
+    state->isr_mode = mode;
+}
+
+void detachInterrupt(int interrupt) {
+    PinState *state = get_pin(interrupt);
+    if (state == nullptr) return;
+    state->isr = nullptr;
+}
+
+String::String(float value, unsigned char decimals)
+    : String(static_cast<double>(value), decimals) {}
+
+String::String(double value, unsigned char decimals) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    str_ = buffer;
+}
+
+void HardwareSerial::begin(unsigned long baud) { (void)baud; }
+
+int HardwareSerial::available(void) { return serial_rx.size(); }
+
+// The host never blocks on TX, report the size of the AVR hardware buffer.
+int HardwareSerial::availableForWrite(void) { return 63; }
+
+int HardwareSerial::peek(void) { return serial_rx.empty() ? -1 : serial_rx.front(); }
+
+int HardwareSerial::read(void) {
+    if (serial_rx.empty()) return -1;
+    uint8_t c = serial_rx.front();
+    serial_rx.pop_front();
+    return c;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    serial_tx.push_back(static_cast<char>(c));
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    serial_tx.append(reinterpret_cast<const char *>(buffer), size);
+    return size;
+}
+
+size_t HardwareSerial::print(unsigned char value, int base) {
+    return print(static_cast<unsigned long>(value), base);
+}
+
+size_t HardwareSerial::print(int value, int base) {
+    return print(static_cast<long>(value), base);
+}
+
+size_t HardwareSerial::print(unsigned int value, int base) {
+    return print(static_cast<unsigned long>(value), base);
+}
+
+size_t HardwareSerial::print(long value, int base) {
+    char buffer[24];
+    if (base == HEX) {
+        snprintf(buffer, sizeof(buffer), "%lX", static_cast<unsigned long>(value));
+    } else {
+        snprintf(buffer, sizeof(buffer), "%ld", value);
+    }
+    return write(buffer);
+}
+
+size_t HardwareSerial::print(unsigned long value, int base) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%lu", value);
+    return write(buffer);
+}
+
+size_t HardwareSerial::print(double value, int digits) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return write(buffer);
+}
+
+uint8_t EEPROMClass::read(int idx) {
+    return idx >= 0 && idx < native_hal::EEPROM_SIZE ? eeprom.bytes[idx] : 0xFF;
+}
+
+void EEPROMClass::write(int idx, uint8_t val) {
+    if (idx < 0 || idx >= native_hal::EEPROM_SIZE) return;
+    eeprom.bytes[idx] = val;
+    eeprom_writes++;
+}
+
+void EEPROMClass::update(int idx, uint8_t val) {
+    if (read(idx) != val) write(idx, val);
+}
+
+uint16_t EEPROMClass::length(void) { return native_hal::EEPROM_SIZE; }
+
+// -----------------------------------------------------------------------------
+// ---------------------------| Simulation controls |---------------------------
+// -----------------------------------------------------------------------------
+
+namespace native_hal {
+
+void reset(void) {
+    now_us = 0;
+    for (auto &pin : pins) {
+        pin = PinState();
+    }
+    serial_rx.clear();
+    serial_tx.clear();
+    attach_timer(0, nullptr);
+}
+
+void advance_micros(uint32_t us) {
+    uint64_t target = now_us + us;
+    while (timer_period_us > 0 && timer_deadline_us <= target) {
+        now_us = timer_deadline_us;
+        timer_deadline_us += timer_period_us;
+        timer_callback();
+    }
+    now_us = target;
+}
+
+void attach_timer(uint32_t period_us, void (*callback)(void)) {
+    timer_period_us = callback == nullptr ? 0 : period_us;
+    timer_callback = callback;
+    timer_deadline_us = now_us + period_us;
+}
+
+int analog_output(uint8_t pin) {
+    PinState *state = get_pin(pin);
+    return state == nullptr ? 0 : state->analog;
+}
+
+uint32_t analog_write_count(uint8_t pin) {
+    PinState *state = get_pin(pin);
+    return state == nullptr ? 0 : state->analog_writes;
+}
+
+int digital_output(uint8_t pin) { return digitalRead(pin); }
+
+void set_input(uint8_t pin, int level) {
+    PinState *state = get_pin(pin);
+    if (state == nullptr) return;
+
+    int previous = state->digital;
+    state->digital = level ? HIGH : LOW;
+    if (state->isr == nullptr || previous == state->digital) {
+        return;
+    }
+
+    bool rising = state->digital == HIGH;
+    if (state->isr_mode == CHANGE || (state->isr_mode == RISING && rising) ||
+        (state->isr_mode == FALLING && !rising)) {
+        state->isr();
+    }
+}
+
+void serial_inject(const char *data) {
+    serial_inject(reinterpret_cast<const uint8_t *>(data), strlen(data));
+}
+
+void serial_inject(const uint8_t *data, size_t size) {
+    serial_rx.insert(serial_rx.end(), data, data + size);
+}
+
+std::string serial_take_output(void) {
+    std::string output;
+    output.swap(serial_tx);
+    return output;
+}
+
+void eeprom_erase(void) { memset(eeprom.bytes, 0xFF, sizeof(eeprom.bytes)); }
+
+uint32_t eeprom_write_count(void) { return eeprom_writes; }
+
+}  // namespace native_hal
@@ -0,0 +1,109 @@
+#ifndef NATIVE_HAL_HPP
+#define NATIVE_HAL_HPP
+
+#include <Arduino.h>
+
+#include <string>
+
+/**
+ * @namespace native_hal
+ * @brief Simulation-side controls of the host Arduino shim.
+ *
+ * @details The firmware only sees the regular Arduino API declared in Arduino.h.
+ * The functions below are used by the simulation to drive time, feed inputs and
+ * observe outputs.
+ */
+namespace native_hal {
+
+/**
+ * @brief Maximum number of pins handled by the shim.
+ */
+constexpr uint8_t NUM_PINS = 32;
+
+/**
+ * @brief Size of the simulated EEPROM (ATmega328).
+ */
+constexpr uint16_t EEPROM_SIZE = 1024;
+
+/**
+ * @brief Reset time, pin states, interrupts and serial buffers.
+ */
+void reset(void);
+
+/**
+ * @brief Advance the simulated clock.
+ * @param us The number of microseconds to advance.
+ */
+void advance_micros(uint32_t us);
+
+/**
+ * @brief Attach a periodic timer interrupt, fired by advance_micros() at each
+ * deadline. Stands in for the AVR hardware timers.
+ * @param period_us The period (in microseconds), 0 to detach.
+ * @param callback The interrupt handler.
+ */
+void attach_timer(uint32_t period_us, void (*callback)(void));
+
+/**
+ * @brief Get the last value written with analogWrite() to a pin.
+ * @param pin The pin number.
+ * @return The PWM value (0-255).
+ */
+int analog_output(uint8_t pin);
+
+/**
+ * @brief Get the number of analogWrite() calls made on a pin since reset.
+ * @param pin The pin number.
+ * @return The number of writes.
+ */
+uint32_t analog_write_count(uint8_t pin);
+
+/**
+ * @brief Get the last value written with digitalWrite() to a pin.
+ * @param pin The pin number.
+ * @return HIGH or LOW.
+ */
+int digital_output(uint8_t pin);
+
+/**
+ * @brief Drive an input pin from the outside world. Fires the attached
+ * interrupt if the level change matches its trigger mode.
+ * @param pin The pin number.
+ * @param level HIGH or LOW.
+ */
+void set_input(uint8_t pin, int level);
+
+/**
+ * @brief Queue bytes to be read by the firmware through Serial.
+ * @param data Null-terminated string to queue.
+ */
+void serial_inject(const char *data);
+
+/**
+ * @brief Queue raw bytes to be read by the firmware through Serial.
+ * @param data The bytes to queue.
+ * @param size The number of bytes.
+ */
+void serial_inject(const uint8_t *data, size_t size);
+
+/**
+ * @brief Take everything the firmware wrote to Serial since the last call.
+ * @return The captured bytes.
+ */
+std::string serial_take_output(void);
+
+/**
+ * @brief Erase the simulated EEPROM (all bytes 0xFF). Not done by reset(), the
+ * EEPROM keeps its content across resets of the board.
+ */
+void eeprom_erase(void);
+
+/**
+ * @brief Get the number of bytes written to the EEPROM since startup.
+ * @return The number of writes.
+ */
+uint32_t eeprom_write_count(void);
+
+}  // namespace native_hal
+
+#endif  // !NATIVE_HAL_HPP
@@ -0,0 +1,19 @@
+#ifndef NATIVE_UTIL_ATOMIC_H
+#define NATIVE_UTIL_ATOMIC_H
+
+/**
+ * @file atomic.h
+ * @brief Host-side replacement for the avr-libc <util/atomic.h>.
+ *
+ * @details Interrupts are fired synchronously from the simulation thread, so an
+ * atomic block only has to run its body once.
+ */
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON 1
+
+#define ATOMIC_BLOCK(type) \
+    for (int atomic_block_once_ = ((void)(type), 1); atomic_block_once_; \
+         atomic_block_once_ = 0)
+
+#endif  // !NATIVE_UTIL_ATOMIC_H
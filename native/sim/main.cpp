@@ -0,0 +1,209 @@
+/**
+ * @file main.cpp
+ * @brief Host simulation of the firmware: runs the real setup()/loop() from
+ * src/main.cpp against the Arduino shim and two simulated motors.
+ *
+ * Usage: program [--duration s] [--step-us us] [--echo] ["time_s:command" ...]
+ *
+ * Commands are serial protocol lines injected at the given simulated time. When
+ * no command is given, a default drive scenario is used. At the end, the
+ * simulation reports the host cost of the loop and of each control tick, the
+ * wheel speed tracking error and the odometry error against ground truth.
+ */
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "configuration.hpp"
+#include "motor_plant.hpp"
+#include "native_hal.hpp"
+
+void setup(void);
+void loop(void);
+
+namespace {
+
+struct ScheduledCommand {
+    double time;
+    std::string line;
+};
+
+const std::vector<ScheduledCommand> DEFAULT_SCENARIO = {
+    {0.0, "c 300 0"},
+    {3.0, "c 200 1000"},
+    {6.0, "c 0 -1000"},
+    {9.0, "c -300 0"},
+    {11.0, "c 0 0"},
+};
+
+// Plant parameters of the stock yellow gearmotor (~300 rpm at 6V).
+const float PLANT_MAX_SPEED = 32.0;     // rad/s
+const float PLANT_TIME_CONSTANT = 0.08;  // s
+const uint8_t PLANT_DEADBAND_PWM = 40;
+
+// Both the left motor and its encoder are mounted mirrored, see src/main.cpp.
+const int LEFT_FORWARD_SIGN = -1;
+const int RIGHT_FORWARD_SIGN = 1;
+
+struct Options {
+    double duration = 12.0;
+    uint32_t step_us = 200;
+    bool echo = false;
+    std::vector<ScheduledCommand> commands;
+};
+
+bool parse_options(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--duration" && i + 1 < argc) {
+            options.duration = atof(argv[++i]);
+        } else if (arg == "--step-us" && i + 1 < argc) {
+            options.step_us = atoi(argv[++i]);
+        } else if (arg == "--echo") {
+            options.echo = true;
+        } else if (arg.find(':') != std::string::npos) {
+            size_t sep = arg.find(':');
+            options.commands.push_back({atof(arg.substr(0, sep).c_str()),
+                                        arg.substr(sep + 1)});
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--duration s] [--step-us us] [--echo] "
+                    "[\"time_s:command\" ...]\n",
+                    argv[0]);
+            return false;
+        }
+    }
+    if (options.commands.empty()) {
+        options.commands = DEFAULT_SCENARIO;
+    }
+    return options.step_us > 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+
+    MotorPlant left_plant({GPIO_MOTOR_LEFT_EN,
+                           GPIO_MOTOR_LEFT_IN1,
+                           GPIO_MOTOR_LEFT_IN2,
+                           GPIO_MOTOR_LEFT_ENCODER_A,
+                           GPIO_MOTOR_LEFT_ENCODER_B,
+                           ENCODER_TICKS_PER_REVOLUTION,
+                           PLANT_MAX_SPEED,
+                           PLANT_TIME_CONSTANT,
+                           PLANT_DEADBAND_PWM});
+    MotorPlant right_plant({GPIO_MOTOR_RIGHT_EN,
+                            GPIO_MOTOR_RIGHT_IN1,
+                            GPIO_MOTOR_RIGHT_IN2,
+                            GPIO_MOTOR_RIGHT_ENCODER_A,
+                            GPIO_MOTOR_RIGHT_ENCODER_B,
+                            ENCODER_TICKS_PER_REVOLUTION,
+                            PLANT_MAX_SPEED,
+                            PLANT_TIME_CONSTANT,
+                            PLANT_DEADBAND_PWM});
+
+    setup();
+
+    const float dt = options.step_us * 1e-6f;
+    const uint64_t steps = uint64_t(options.duration * 1e6 / options.step_us);
+    size_t next_command = 0;
+    float target_x = 0.0, target_w = 0.0;
+
+    // Ground truth
+    double x = 0.0, y = 0.0, theta = 0.0;
+
+    // Statistics
+    using clock = std::chrono::steady_clock;
+    double loop_ns_total = 0.0, tick_ns_total = 0.0, loop_ns_max = 0.0;
+    uint64_t tick_count = 0;
+    double sq_error_sum = 0.0;
+
+    for (uint64_t step = 0; step < steps; step++) {
+        double now = step * dt;
+        while (next_command < options.commands.size() &&
+               options.commands[next_command].time <= now) {
+            const std::string &line = options.commands[next_command].line;
+            int cmd_x, cmd_w;
+            if (sscanf(line.c_str(), "c %d %d", &cmd_x, &cmd_w) == 2) {
+                target_x = cmd_x / 1000.0;
+                target_w = cmd_w / 1000.0;
+            }
+            native_hal::serial_inject((line + "\n").c_str());
+            next_command++;
+        }
+
+        // The control loop runs either from loop() or, with CONTROL_LOOP_TIMER_ISR,
+        // from the timer interrupt fired by advance_micros().
+        uint32_t writes_before = native_hal::analog_write_count(GPIO_MOTOR_RIGHT_EN);
+        auto start = clock::now();
+        loop();
+        native_hal::advance_micros(options.step_us);
+        double elapsed = std::chrono::duration<double, std::nano>(clock::now() - start)
+                             .count();
+        loop_ns_total += elapsed;
+        if (elapsed > loop_ns_max) loop_ns_max = elapsed;
+
+        double v_l = LEFT_FORWARD_SIGN * left_plant.get_angular_velocity() * WHEEL_RADIUS;
+        double v_r =
+            RIGHT_FORWARD_SIGN * right_plant.get_angular_velocity() * WHEEL_RADIUS;
+
+        if (native_hal::analog_write_count(GPIO_MOTOR_RIGHT_EN) != writes_before) {
+            tick_count++;
+            tick_ns_total += elapsed;
+            double e_l = (target_x - target_w * DIST_BETWEEN_WHEELS / 2) - v_l;
+            double e_r = (target_x + target_w * DIST_BETWEEN_WHEELS / 2) - v_r;
+            sq_error_sum += (e_l * e_l + e_r * e_r) / 2;
+        }
+
+        std::string output = native_hal::serial_take_output();
+        if (options.echo && !output.empty()) {
+            fputs(output.c_str(), stdout);
+        }
+
+        left_plant.step(dt);
+        right_plant.step(dt);
+
+        x += (v_l + v_r) / 2 * cos(theta) * dt;
+        y += (v_l + v_r) / 2 * sin(theta) * dt;
+        theta += (v_r - v_l) / DIST_BETWEEN_WHEELS * dt;
+    }
+
+    // Read the firmware's odometry through the protocol, like the host would.
+    native_hal::serial_inject("q\n");
+    loop();
+    float odom_x = 0, odom_y = 0, odom_theta = 0;
+    std::string pose = native_hal::serial_take_output();
+    sscanf(pose.c_str(), "%f %f %f", &odom_x, &odom_y, &odom_theta);
+    double theta_error = remainder(odom_theta - theta, TWO_PI);
+
+    printf("simulated %.2f s in %.3f s (%.0fx real time)\n",
+           options.duration,
+           loop_ns_total * 1e-9,
+           options.duration / (loop_ns_total * 1e-9));
+    printf("loop passes: %llu, mean %.0f ns, max %.0f ns\n",
+           (unsigned long long)steps,
+           loop_ns_total / steps,
+           loop_ns_max);
+    printf("control ticks: %llu, mean %.0f ns per tick\n",
+           (unsigned long long)tick_count,
+           tick_count ? tick_ns_total / tick_count : 0.0);
+    printf("wheel speed tracking error: %.4f m/s rms\n",
+           tick_count ? sqrt(sq_error_sum / tick_count) : 0.0);
+    printf("odometry: %.3f %.3f %.3f, truth: %.3f %.3f %.3f, error: %.3f m %.3f rad\n",
+           odom_x,
+           odom_y,
+           odom_theta,
+           x,
+           y,
+           remainder(theta, TWO_PI),
+           hypot(odom_x - x, odom_y - y),
+           fabs(theta_error));
+    return 0;
+}
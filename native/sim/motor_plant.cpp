@@ -0,0 +1,56 @@
+#include "motor_plant.hpp"
+
+#include "native_hal.hpp"
+
+// Gray-code sequence of (A, B) for positive rotation: A rises while B is low.
+static const uint8_t QUADRATURE_SEQUENCE[4][2] = {
+    {LOW, LOW}, {HIGH, LOW}, {HIGH, HIGH}, {LOW, HIGH}};
+
+MotorPlant::MotorPlant(const MotorPlantConfig &config) : config_(config) { reset(); }
+
+void MotorPlant::reset(void) {
+    angular_velocity_ = 0.0;
+    angle_ = 0.0;
+    quadrature_count_ = 0;
+    edge_count_ = 0;
+    native_hal::set_input(config_.pin_encoder_a, LOW);
+    native_hal::set_input(config_.pin_encoder_b, LOW);
+}
+
+float MotorPlant::read_drive_(void) const {
+    int in1 = native_hal::digital_output(config_.pin_in1);
+    int in2 = native_hal::digital_output(config_.pin_in2);
+    int pwm = native_hal::analog_output(config_.pin_en);
+
+    if (in1 == in2 || pwm <= config_.deadband_pwm) {
+        return 0.0;
+    }
+
+    float drive =
+        float(pwm - config_.deadband_pwm) / float(255 - config_.deadband_pwm);
+    return in1 == HIGH ? drive : -drive;
+}
+
+void MotorPlant::step(float dt) {
+    float target = read_drive_() * config_.max_speed;
+    angular_velocity_ += (target - angular_velocity_) * dt / config_.time_constant;
+    angle_ += angular_velocity_ * dt;
+
+    int64_t target_count =
+        int64_t(floor(angle_ / TWO_PI * config_.ticks_per_rev * 4.0));
+    while (quadrature_count_ < target_count) {
+        emit_step_(1);
+    }
+    while (quadrature_count_ > target_count) {
+        emit_step_(-1);
+    }
+}
+
+void MotorPlant::emit_step_(int direction) {
+    quadrature_count_ += direction;
+    const uint8_t *phases = QUADRATURE_SEQUENCE[quadrature_count_ & 0x3];
+    // Only one phase changes per step, set_input() ignores the unchanged one.
+    native_hal::set_input(config_.pin_encoder_a, phases[0]);
+    native_hal::set_input(config_.pin_encoder_b, phases[1]);
+    edge_count_++;
+}
@@ -0,0 +1,91 @@
+#ifndef MOTOR_PLANT_HPP
+#define MOTOR_PLANT_HPP
+
+#include <Arduino.h>
+
+/**
+ * @struct MotorPlantConfig
+ * @brief Wiring and physical parameters of a simulated DC gearmotor with a
+ * quadrature encoder.
+ */
+typedef struct {
+    uint8_t pin_en;            ///< L298N enable pin (PWM input of the plant).
+    uint8_t pin_in1;           ///< L298N input 1 pin.
+    uint8_t pin_in2;           ///< L298N input 2 pin.
+    uint8_t pin_encoder_a;     ///< Encoder phase A pin (output of the plant).
+    uint8_t pin_encoder_b;     ///< Encoder phase B pin (output of the plant).
+    uint16_t ticks_per_rev;    ///< Encoder cycles (rising edges of A) per revolution.
+    float max_speed;           ///< No-load wheel speed at full PWM (in rad/s).
+    float time_constant;       ///< Mechanical time constant (in seconds).
+    uint8_t deadband_pwm;      ///< PWM below which static friction holds the wheel.
+} MotorPlantConfig;
+
+/**
+ * @class MotorPlant
+ * @brief First-order simulation of a DC motor driven through an L298N, producing
+ * quadrature encoder edges on the shim's input pins.
+ *
+ * @details Positive rotation is the direction the motor turns with IN1 high and
+ * IN2 low. It produces phase A leading phase B, which the Encoder class counts
+ * up. Direction flags of the firmware are therefore exercised exactly as they
+ * would be with real wiring.
+ */
+class MotorPlant {
+   public:
+    /**
+     * @brief Constructor for the MotorPlant class.
+     * @param config The wiring and physical parameters of the motor.
+     */
+    MotorPlant(const MotorPlantConfig &config);
+
+    /**
+     * @brief Reset the wheel to rest and drive both encoder phases low.
+     */
+    void reset(void);
+
+    /**
+     * @brief Advance the simulation, reading the driver pins and emitting encoder
+     * edges for the distance travelled.
+     * @param dt The time step (in seconds).
+     */
+    void step(float dt);
+
+    /**
+     * @brief Get the true wheel angular velocity.
+     * @return The angular velocity (in rad/s).
+     */
+    float get_angular_velocity(void) const { return angular_velocity_; }
+
+    /**
+     * @brief Get the true wheel angle.
+     * @return The angle (in radians).
+     */
+    double get_angle(void) const { return angle_; }
+
+    /**
+     * @brief Get the number of quadrature edges emitted since reset.
+     * @return The edge count.
+     */
+    uint32_t get_edge_count(void) const { return edge_count_; }
+
+   private:
+    /**
+     * @brief Compute the normalized drive (-1 to 1) applied by the L298N.
+     */
+    float read_drive_(void) const;
+
+    /**
+     * @brief Emit one quadrature step in the given direction.
+     * @param direction +1 or -1.
+     */
+    void emit_step_(int direction);
+
+   private:
+    MotorPlantConfig config_;   ///< Wiring and physical parameters.
+    float angular_velocity_;    ///< True wheel speed (in rad/s).
+    double angle_;              ///< True wheel angle (in radians).
+    int64_t quadrature_count_;  ///< Quarter cycles emitted so far.
+    uint32_t edge_count_;       ///< Number of edges emitted.
+};
+
+#endif  // !MOTOR_PLANT_HPP
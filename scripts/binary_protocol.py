@@ -0,0 +1,143 @@
+import struct
+
+# Host side of the binary serial protocol, see include/binary_protocol.hpp.
+#
+# Example:
+#   with serial.Serial("/dev/ttyUSB0", 9600, timeout=1) as ser:
+#       enter_binary_mode(ser)
+#       ser.write(encode_frame(MSG_CMD_VEL, struct.pack("<ff", 0.3, 0.0)))
+#       print(read_frame(ser))
+
+MSG_CMD_VEL = 0x01
+MSG_OPEN_LOOP = 0x02
+MSG_POSE_GET = 0x03
+MSG_MOTOR_STATUS_GET = 0x04
+MSG_RESET_POSE = 0x05
+MSG_PID_SET = 0x06
+MSG_PID_GET = 0x07
+MSG_TEXT_MODE = 0x08
+MSG_TELEMETRY_SET = 0x09
+MSG_FEEDFORWARD_SET = 0x0A
+MSG_FEEDFORWARD_GET = 0x0B
+MSG_AUTOTUNE_START = 0x0C
+MSG_AUTOTUNE_GET = 0x0D
+MSG_GAIN_BREAKPOINT_SET = 0x0E
+MSG_GAIN_SCHEDULE_GET = 0x0F
+MSG_GEOMETRY_SET = 0x10
+MSG_GEOMETRY_GET = 0x11
+MSG_PARAMS_SAVE = 0x12
+MSG_TASK_STATS_GET = 0x13
+MSG_PROFILE_GET = 0x14
+MSG_RECORDER_START = 0x15
+MSG_RECORDER_GET = 0x16
+MSG_CMD_VEL_REPORT = 0x17
+MSG_MOVE = 0x18
+MSG_ACK = 0x80
+MSG_POSE = 0x81
+MSG_MOTOR_STATUS = 0x82
+MSG_PID_GAINS = 0x83
+MSG_TELEMETRY = 0x84
+MSG_FEEDFORWARD_GAINS = 0x85
+MSG_AUTOTUNE_STATUS = 0x86
+MSG_GAIN_SCHEDULE = 0x87
+MSG_GEOMETRY = 0x88
+MSG_PARAMS_SAVED = 0x89
+MSG_TASK_STATS = 0x8A
+MSG_PROFILE = 0x8B
+MSG_RECORDER_DATA = 0x8C
+MSG_STATE = 0x8D
+MSG_MOVE_DONE = 0x8E
+
+# Same as include/configuration.hpp
+PID_GAIN_SCHEDULE_SIZE = 4
+MAX_WHEELS = 2
+SCHEDULER_MAX_TASKS = 4
+PROFILE_STAGE_COUNT = 6
+PROFILER_HISTOGRAM_BINS = 10
+BINARY_RECORDER_CHUNK_SIZE = 4
+
+PAYLOAD_FORMATS = {
+    MSG_ACK: "<Bb",
+    MSG_POSE: "<fff",
+    MSG_MOTOR_STATUS: "<" + "fffff" * MAX_WHEELS,
+    MSG_PID_GAINS: "<fff",
+    MSG_TELEMETRY: "<IIfff" + "fffff" * MAX_WHEELS,
+    MSG_FEEDFORWARD_GAINS: "<fff",
+    MSG_AUTOTUNE_STATUS: "<B" + "ff" * MAX_WHEELS,
+    MSG_GAIN_SCHEDULE: "<BB" + "ffff" * PID_GAIN_SCHEDULE_SIZE,
+    MSG_GEOMETRY: "<ffH",
+    MSG_PARAMS_SAVED: "<H",
+    MSG_TASK_STATS: "<B" + "IHHH" * SCHEDULER_MAX_TASKS,
+    MSG_PROFILE: "<" + "HHHH" * PROFILE_STAGE_COUNT + "H" * PROFILER_HISTOGRAM_BINS,
+    MSG_RECORDER_DATA: "<BBBBB" + "hhhb" * MAX_WHEELS * BINARY_RECORDER_CHUNK_SIZE,
+    MSG_STATE: "<Ifff" + "fffff" * MAX_WHEELS,
+    MSG_MOVE_DONE: "<Bff",
+}
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for byte in data:
+        if byte == 0:
+            out.append(len(block) + 1)
+            out += block
+            block = bytearray()
+        else:
+            block.append(byte)
+            if len(block) == 254:
+                out.append(255)
+                out += block
+                block = bytearray()
+    out.append(len(block) + 1)
+    out += block
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("invalid COBS frame")
+        out += data[i + 1 : i + code]
+        i += code
+        if code != 255 and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(msg_id, payload=b""):
+    raw = bytes([msg_id]) + payload
+    return cobs_encode(raw + struct.pack("<H", crc16(raw))) + b"\x00"
+
+
+def decode_frame(frame):
+    """Decode a frame (without its delimiter) into (msg_id, values)."""
+    raw = cobs_decode(frame)
+    if len(raw) < 3 or struct.unpack("<H", raw[-2:])[0] != crc16(raw[:-2]):
+        raise ValueError("invalid CRC")
+    msg_id, payload = raw[0], raw[1:-2]
+    fmt = PAYLOAD_FORMATS.get(msg_id)
+    return msg_id, struct.unpack(fmt, payload) if fmt else payload
+
+
+def enter_binary_mode(ser):
+    ser.write(b"b\n")
+    ser.readline()  # OK
+
+
+def read_frame(ser):
+    frame = ser.read_until(b"\x00")
+    return decode_frame(frame[:-1])
@@ -0,0 +1,160 @@
+import argparse
+import csv
+import struct
+import time
+
+from binary_protocol import (
+    MSG_OPEN_LOOP,
+    MSG_TELEMETRY,
+    MSG_TELEMETRY_SET,
+    MSG_TEXT_MODE,
+    encode_frame,
+    enter_binary_mode,
+    read_frame,
+)
+
+# Estimate the feed-forward gains of the motor drivers from an open-loop PWM sweep.
+#
+# The sweep steps both motors up then down through PWM values while streaming
+# telemetry, so that the recording contains both steady-state speeds (ks, kv) and
+# transients (ka). The model pwm = ks + kv * v + ka * a is then fitted by least
+# squares on the samples where the wheel moves.
+#
+# Usage:
+#   python fit_feedforward.py --port /dev/ttyUSB0 --output sweep.csv
+#   python fit_feedforward.py --input sweep.csv
+#
+# The input CSV has the columns: time, left_pwm, right_pwm, left_velocity,
+# right_velocity (seconds, PWM, m/s).
+
+TELEMETRY_RATE = 20  # Hz
+LEFT_VELOCITY = 6  # Index in the MSG_TELEMETRY values
+RIGHT_VELOCITY = 11
+MIN_VELOCITY = 0.02  # m/s, samples below are in the deadband
+
+
+def record_sweep(port, baud, pwm_values, hold):
+    import serial
+
+    samples = []
+    with serial.Serial(port, baud, timeout=0.5) as ser:
+        time.sleep(2)
+        enter_binary_mode(ser)
+        ser.write(encode_frame(MSG_TELEMETRY_SET, struct.pack("<B", TELEMETRY_RATE)))
+        for pwm in pwm_values:
+            ser.write(encode_frame(MSG_OPEN_LOOP, struct.pack("<BB", pwm, pwm)))
+            end = time.time() + hold
+            while time.time() < end:
+                try:
+                    msg_id, values = read_frame(ser)
+                except ValueError:
+                    continue
+                if msg_id != MSG_TELEMETRY:
+                    continue
+                samples.append(
+                    (
+                        values[1] / 1000.0,
+                        pwm,
+                        pwm,
+                        values[LEFT_VELOCITY],
+                        values[RIGHT_VELOCITY],
+                    )
+                )
+        ser.write(encode_frame(MSG_OPEN_LOOP, struct.pack("<BB", 0, 0)))
+        ser.write(encode_frame(MSG_TELEMETRY_SET, struct.pack("<B", 0)))
+        ser.write(encode_frame(MSG_TEXT_MODE))
+    return samples
+
+
+def read_csv(path):
+    with open(path, newline="") as f:
+        reader = csv.reader(f)
+        next(reader)
+        return [tuple(float(v) for v in row) for row in reader]
+
+
+def write_csv(path, samples):
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(
+            ["time", "left_pwm", "right_pwm", "left_velocity", "right_velocity"]
+        )
+        writer.writerows(samples)
+
+
+def solve(a, b):
+    """Solve the linear system a x = b by Gaussian elimination."""
+    n = len(b)
+    m = [row[:] + [b[i]] for i, row in enumerate(a)]
+    for col in range(n):
+        pivot = max(range(col, n), key=lambda r: abs(m[r][col]))
+        m[col], m[pivot] = m[pivot], m[col]
+        if abs(m[col][col]) < 1e-12:
+            raise ValueError("not enough excitation to fit the model")
+        for r in range(n):
+            if r != col:
+                f = m[r][col] / m[col][col]
+                m[r] = [x - f * y for x, y in zip(m[r], m[col])]
+    return [m[i][n] / m[i][i] for i in range(n)]
+
+
+def fit_wheel(times, pwms, velocities):
+    """Fit pwm = ks + kv * v + ka * a, with a from central differences."""
+    rows = []
+    for i in range(1, len(times) - 1):
+        v = velocities[i]
+        dt = times[i + 1] - times[i - 1]
+        if abs(v) < MIN_VELOCITY or dt <= 0:
+            continue
+        a = (velocities[i + 1] - velocities[i - 1]) / dt
+        rows.append(([1.0, v, a], pwms[i]))
+
+    if len(rows) < 3:
+        raise ValueError("not enough moving samples")
+
+    ata = [[sum(x[i] * x[j] for x, _ in rows) for j in range(3)] for i in range(3)]
+    atb = [sum(x[i] * y for x, y in rows) for i in range(3)]
+    ks, kv, ka = solve(ata, atb)
+
+    residuals = [y - (ks * x[0] + kv * x[1] + ka * x[2]) for x, y in rows]
+    rms = (sum(r * r for r in residuals) / len(residuals)) ** 0.5
+    return ks, kv, ka, rms
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Estimate the feed-forward gains of the motor drivers."
+    )
+    parser.add_argument("--port", help="serial port of the motor controller")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--input", help="fit a previously recorded sweep")
+    parser.add_argument("--output", help="save the recorded sweep")
+    parser.add_argument("--step", type=int, default=25, help="PWM step of the sweep")
+    parser.add_argument("--hold", type=float, default=1.5, help="seconds per step")
+    args = parser.parse_args()
+
+    if args.input:
+        samples = read_csv(args.input)
+    elif args.port:
+        up = list(range(0, 251, args.step))
+        samples = record_sweep(args.port, args.baud, up + up[-2::-1], args.hold)
+        if args.output:
+            write_csv(args.output, samples)
+    else:
+        parser.error("either --port or --input is required")
+
+    times = [s[0] for s in samples]
+    gains = []
+    for name, pwm_col, vel_col in (("left", 1, 3), ("right", 2, 4)):
+        ks, kv, ka, rms = fit_wheel(
+            times, [s[pwm_col] for s in samples], [s[vel_col] for s in samples]
+        )
+        gains.append((ks, kv, ka))
+        print(f"{name}: ks={ks:.1f} kv={kv:.1f} ka={ka:.2f} (rms error {rms:.1f} PWM)")
+
+    ks, kv, ka = (sum(g[i] for g in gains) / len(gains) for i in range(3))
+    print(f"command: f {round(ks)} {round(kv)} {round(ka)}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,62 @@
+#include "binary_protocol.hpp"
+
+#ifdef __AVR__
+#include <util/crc16.h>
+#endif
+
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc) {
+    for (size_t i = 0; i < len; i++) {
+#ifdef __AVR__
+        // Non-reflected 0x1021 update, the init value is ours.
+        crc = _crc_xmodem_update(crc, data[i]);
+#else
+        crc ^= uint16_t(data[i]) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+#endif
+    }
+    return crc;
+}
+
+size_t cobs_encode_in_place(uint8_t *buffer, size_t len) {
+    // The write index never passes the read index as long as no block reaches
+    // 254 bytes, which is guaranteed by len < 254.
+    size_t code_index = 0;
+    size_t write_index = 1;
+    uint8_t code = 1;
+
+    for (size_t read_index = 1; read_index <= len; read_index++) {
+        uint8_t byte = buffer[read_index];
+        if (byte == 0) {
+            buffer[code_index] = code;
+            code_index = write_index++;
+            code = 1;
+        } else {
+            buffer[write_index++] = byte;
+            code++;
+        }
+    }
+    buffer[code_index] = code;
+    return write_index;
+}
+
+size_t cobs_decode_in_place(uint8_t *buffer, size_t len) {
+    size_t read_index = 0;
+    size_t write_index = 0;
+
+    while (read_index < len) {
+        uint8_t code = buffer[read_index];
+        if (code == 0 || read_index + code > len) {
+            return 0;
+        }
+        read_index++;
+        for (uint8_t i = 1; i < code; i++) {
+            buffer[write_index++] = buffer[read_index++];
+        }
+        if (code != 0xFF && read_index < len) {
+            buffer[write_index++] = 0;
+        }
+    }
+    return write_index;
+}
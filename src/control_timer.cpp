@@ -0,0 +1,51 @@
+#include "control_timer.hpp"
+
+#ifdef __AVR__
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "configuration.hpp"
+
+#if CONTROL_LOOP_TIMER_ISR && (GPIO_MOTOR_LEFT_EN == 9 || GPIO_MOTOR_LEFT_EN == 10 || \
+                               GPIO_MOTOR_RIGHT_EN == 9 || GPIO_MOTOR_RIGHT_EN == 10)
+#error "CONTROL_LOOP_TIMER_ISR uses Timer1, move the motor enable pins off pins 9 and 10"
+#endif
+
+static void (*volatile control_timer_callback)(void) = nullptr;
+
+void ControlTimer::begin(uint16_t frequency, void (*callback)(void)) {
+    uint8_t sreg = SREG;
+    cli();
+    control_timer_callback = callback;
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);  // CTC, clk / 64
+    TCNT1 = 0;
+    OCR1A = F_CPU / 64 / frequency - 1;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 |= _BV(OCIE1A);
+    SREG = sreg;
+}
+
+void ControlTimer::end(void) { TIMSK1 &= ~_BV(OCIE1A); }
+
+ISR(TIMER1_COMPA_vect) {
+    // Mask ourselves and let the encoder interrupts preempt the control step.
+    TIMSK1 &= ~_BV(OCIE1A);
+    sei();
+    control_timer_callback();
+    cli();
+    TIMSK1 |= _BV(OCIE1A);
+}
+
+#else
+
+#include "native_hal.hpp"
+
+void ControlTimer::begin(uint16_t frequency, void (*callback)(void)) {
+    native_hal::attach_timer(1000000UL / frequency, callback);
+}
+
+void ControlTimer::end(void) { native_hal::attach_timer(0, nullptr); }
+
+#endif
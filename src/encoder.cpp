@@ -1,31 +1,88 @@
 #include "encoder.hpp"
 
+#include <util/atomic.h>
+
 #include "Arduino.h"
 
+// Phase A leads phase B when counting up: 00 -> 10 -> 11 -> 01 -> 00, like
+// tick_isr() counting up on a rising A while B is LOW.
+const int8_t Encoder::QUADRATURE_TABLE_[16] = {
+    0,  -1, 1,  QUADRATURE_ILLEGAL_,  // from 00
+    1,  0,  QUADRATURE_ILLEGAL_, -1,  // from 01
+    -1, QUADRATURE_ILLEGAL_, 0,  1,   // from 10
+    QUADRATURE_ILLEGAL_, 1,  -1, 0,   // from 11
+};
+
 Encoder::Encoder(uint8_t pin_a, uint8_t pin_b, bool reverse)
-    : pin_a_(pin_a), pin_b_(pin_b), reverse_(reverse), ticks_(0) {
+    : pin_a_(pin_a),
+      pin_b_(pin_b),
+      reverse_(reverse),
+      ticks_(0),
+      edge_time_(0),
+      errors_(0) {
     init_pins();
 }
 
 void Encoder::init_pins() {
     pinMode(pin_a_, INPUT_PULLUP);
     pinMode(pin_b_, INPUT_PULLUP);
+    reset();
 }
 
-void Encoder::reset() { ticks_ = 0; }
+void Encoder::reset() {
+    // The interrupts update both, which must not see a half-written count.
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ticks_ = 0;
+        state_ = (digitalRead(pin_a_) << 1) | digitalRead(pin_b_);
+    }
+}
 
 void Encoder::set_reverse(bool reverse) { reverse_ = reverse; }
 
 int32_t Encoder::get_ticks() {
     int32_t ticks = 0;
-    { ticks = ticks_; }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { ticks = ticks_; }
     return reverse_ ? -ticks : ticks;
 }
 
+void Encoder::read_(EncoderSample &sample) {
+    int32_t ticks = ticks_;
+    sample.ticks = reverse_ ? -ticks : ticks;
+    sample.edge_time = edge_time_;
+}
+
+void Encoder::sample(EncoderSample &sample) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { read_(sample); }
+}
+
+unsigned long Encoder::sample_all(Encoder *const *encoders,
+                                  EncoderSample *samples,
+                                  uint8_t count) {
+    unsigned long time = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint8_t i = 0; i < count; i++) {
+            encoders[i]->read_(samples[i]);
+        }
+        time = micros();
+    }
+    return time;
+}
+
+uint16_t Encoder::get_error_count() {
+    uint16_t errors = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { errors = errors_; }
+    return errors;
+}
+
+void Encoder::quadrature_isr() {
+    decode_((digitalRead(pin_a_) << 1) | digitalRead(pin_b_));
+}
+
 void Encoder::tick_isr() {
     if (digitalRead(pin_b_) == HIGH) {
         ticks_--;
     } else {
         ticks_++;
     }
+    edge_time_ = micros();
 }
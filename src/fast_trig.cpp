@@ -0,0 +1,67 @@
+#include "fast_trig.hpp"
+
+// sin(PI / 2 * i / 64) in Q15, i = 0..64
+static const int16_t SINE_TABLE[65] PROGMEM = {
+    0,     804,   1608,  2410,  3212,  4011,  4808,  5602,  6393,  7179,  7962,
+    8739,  9512,  10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151,
+    16846, 17530, 18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594, 23170,
+    23731, 24279, 24811, 25329, 25832, 26319, 26790, 27245, 27683, 28105, 28510,
+    28898, 29268, 29621, 29956, 30273, 30571, 30852, 31113, 31356, 31580, 31785,
+    31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757, 32767};
+
+// Table steps per radian: 2^16 steps per turn, 8 fractional bits per sample.
+#define STEPS_PER_RAD 10430.378350470453
+
+#define QUARTER_TURN 0x4000
+#define Q15_TO_FLOAT (1.0f / 32767.0f)
+
+/**
+ * @brief Interpolate the quarter wave.
+ * @param pos Position within the quarter wave, within [0, 2^14].
+ * @return The sine (Q15).
+ */
+static int16_t quarter_sine(uint16_t pos) {
+    uint8_t index = pos >> 8;
+    uint8_t frac = pos & 0xFF;
+    int16_t a = pgm_read_word(&SINE_TABLE[index]);
+    if (frac == 0) {
+        return a;
+    }
+    int16_t b = pgm_read_word(&SINE_TABLE[index + 1]);
+    return a + ((int32_t(b - a) * frac) >> 8);
+}
+
+/**
+ * @brief Sine of an angle in table steps.
+ * @param steps The angle, 2^16 steps per turn.
+ * @return The sine (Q15).
+ */
+static int16_t step_sine(uint16_t steps) {
+    uint8_t quadrant = steps >> 14;
+    uint16_t pos = steps & (QUARTER_TURN - 1);
+    if (quadrant & 1) {
+        pos = QUARTER_TURN - pos;
+    }
+    int16_t sine = quarter_sine(pos);
+    return (quadrant & 2) ? -sine : sine;
+}
+
+/**
+ * @brief Convert an angle to table steps, rounded and wrapped to a turn.
+ */
+static uint16_t rad_to_steps(float angle) {
+    float steps = angle * float(STEPS_PER_RAD);
+    return uint16_t(int32_t(steps >= 0 ? steps + 0.5f : steps - 0.5f));
+}
+
+void fast_sincos(float angle, float &sine, float &cosine) {
+    uint16_t steps = rad_to_steps(angle);
+    sine = step_sine(steps) * Q15_TO_FLOAT;
+    cosine = step_sine(steps + QUARTER_TURN) * Q15_TO_FLOAT;
+}
+
+float fast_sin(float angle) { return step_sine(rad_to_steps(angle)) * Q15_TO_FLOAT; }
+
+float fast_cos(float angle) {
+    return step_sine(rad_to_steps(angle) + QUARTER_TURN) * Q15_TO_FLOAT;
+}
@@ -0,0 +1,24 @@
+#include "fixed_point.hpp"
+
+// sin(PI / 2 * z) ~= z * (A - z^2 * (B - z^2 * C)), minimax coefficients in Q14.
+#define SIN5_A 25728L
+#define SIN5_B 10520L
+#define SIN5_C 1177L
+
+int32_t fixed_sin(uint32_t angle) {
+    // 2^16 per turn (rounded) is enough resolution for the polynomial.
+    uint16_t x = (angle + 0x8000UL) >> 16;
+    bool negative = x & 0x8000;
+    x &= 0x7FFF;
+    if (x > 0x4000) {
+        x = 0x8000 - x;
+    }
+
+    // z within [0, 1] (Q14)
+    int32_t z = x;
+    int32_t z2 = (z * z) >> 14;
+    int32_t t = SIN5_B - ((SIN5_C * z2) >> 14);
+    t = SIN5_A - ((t * z2) >> 14);
+    int32_t sine = (t * z) >> 13;
+    return negative ? -sine : sine;
+}
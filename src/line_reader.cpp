@@ -0,0 +1,72 @@
+#include "line_reader.hpp"
+
+LineReader::LineReader()
+    : len_(0), discarding_(false), line_ready_(false), overflows_(0) {}
+
+LineStatus LineReader::push(char c) {
+    if (line_ready_) {
+        len_ = 0;
+        line_ready_ = false;
+    }
+
+    if (c == '\n') {
+        if (discarding_) {
+            discarding_ = false;
+            len_ = 0;
+            return LineStatus::DROPPED;
+        }
+        buffer_[len_] = '\0';
+        line_ready_ = true;
+        return LineStatus::READY;
+    }
+
+    if (discarding_) {
+        return LineStatus::PENDING;
+    }
+
+    // Keep room for the null terminator.
+    if (len_ >= sizeof(buffer_) - 1) {
+        discarding_ = true;
+        overflows_++;
+        return LineStatus::PENDING;
+    }
+    buffer_[len_++] = c;
+    return LineStatus::PENDING;
+}
+
+const char* LineReader::get_line(void) { return buffer_; }
+
+void LineReader::clear(void) {
+    len_ = 0;
+    discarding_ = false;
+    line_ready_ = false;
+}
+
+uint16_t LineReader::get_overflow_count(void) { return overflows_; }
+
+bool parse_int(const char*& cursor, int32_t& value) {
+    const char* p = cursor;
+    while (*p == ' ' || *p == '\t') p++;
+
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-';
+        p++;
+    }
+    if (*p < '0' || *p > '9') {
+        return false;
+    }
+
+    int32_t result = 0;
+    while (*p >= '0' && *p <= '9') {
+        int32_t digit = *p - '0';
+        if (result > (INT32_MAX - digit) / 10) {
+            return false;  // Out of range
+        }
+        result = result * 10 + digit;
+        p++;
+    }
+    value = negative ? -result : result;
+    cursor = p;
+    return true;
+}
@@ -1,39 +1,116 @@
 #include <Arduino.h>
 
 #include "configuration.hpp"
+#include "control_timer.hpp"
+#include "fast_encoder.hpp"
 #include "motor_controller.hpp"
 #include "motor_driver.hpp"
+#include "parameter_store.hpp"
+#include "profiler.hpp"
 #include "serial_protocol.hpp"
+#include "task_scheduler.hpp"
+#include "utils.hpp"
 
-Encoder left_motor_encoder(GPIO_MOTOR_LEFT_ENCODER_A, GPIO_MOTOR_LEFT_ENCODER_B, true);
-Encoder right_motor_encoder(GPIO_MOTOR_RIGHT_ENCODER_A, GPIO_MOTOR_RIGHT_ENCODER_B);
-MotorDriver left_motor(GPIO_MOTOR_LEFT_EN,
-                       GPIO_MOTOR_LEFT_IN1,
-                       GPIO_MOTOR_LEFT_IN2,
-                       &left_motor_encoder,
-                       WHEEL_RADIUS,
-                       ENCODER_TICKS_PER_REVOLUTION,
-                       true);
-MotorDriver right_motor(GPIO_MOTOR_RIGHT_EN,
-                        GPIO_MOTOR_RIGHT_IN1,
-                        GPIO_MOTOR_RIGHT_IN2,
-                        &right_motor_encoder,
-                        WHEEL_RADIUS,
-                        ENCODER_TICKS_PER_REVOLUTION);
-
-MotorController motor_controller(&left_motor, &right_motor, DIST_BETWEEN_WHEELS);
+FastEncoder<GPIO_MOTOR_LEFT_ENCODER_A, GPIO_MOTOR_LEFT_ENCODER_B, true> left_motor_encoder;
+FastEncoder<GPIO_MOTOR_RIGHT_ENCODER_A, GPIO_MOTOR_RIGHT_ENCODER_B> right_motor_encoder;
+
+// One motor driver per driven wheel, in a contiguous array updated in order by the
+// control loop, and the side of each wheel. A 4WD platform lists its front and
+// rear motors of each side, up to MAX_WHEELS.
+MotorDriver motors[] = {
+    {GPIO_MOTOR_LEFT_EN,
+     GPIO_MOTOR_LEFT_IN1,
+     GPIO_MOTOR_LEFT_IN2,
+     &left_motor_encoder,
+     DEFAULT_GEOMETRY.wheel_radius,
+     DEFAULT_GEOMETRY.counts_per_rev(),
+     true},
+    {GPIO_MOTOR_RIGHT_EN,
+     GPIO_MOTOR_RIGHT_IN1,
+     GPIO_MOTOR_RIGHT_IN2,
+     &right_motor_encoder,
+     DEFAULT_GEOMETRY.wheel_radius,
+     DEFAULT_GEOMETRY.counts_per_rev()},
+};
+const WheelSide wheel_sides[] = {SIDE_LEFT, SIDE_RIGHT};
+const uint8_t WHEEL_COUNT = sizeof(motors) / sizeof(motors[0]);
+static_assert(WHEEL_COUNT <= MAX_WHEELS, "more wheels than MAX_WHEELS");
+static_assert(sizeof(wheel_sides) / sizeof(wheel_sides[0]) == WHEEL_COUNT,
+              "one side per wheel");
+
+MotorController motor_controller(
+    motors, wheel_sides, WHEEL_COUNT, DEFAULT_GEOMETRY, DEFAULT_KINEMATICS);
 SerialProtocol serial_protocol(&motor_controller);
 
+#if ENCODER_QUADRATURE_4X
+void encoders_ISR(void) {
+    // Unchanged encoders count nothing, so the source of the interrupt is irrelevant.
+    left_motor_encoder.quadrature_isr();
+    right_motor_encoder.quadrature_isr();
+}
+
+#ifdef __AVR__
+// Only the vectors of the ports enabled by enable_pin_change_interrupt() fire.
+ISR(PCINT0_vect) { encoders_ISR(); }
+ISR(PCINT1_vect) { encoders_ISR(); }
+ISR(PCINT2_vect) { encoders_ISR(); }
+
+void enable_pin_change_interrupt(uint8_t pin) {
+    *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+    PCIFR |= _BV(digitalPinToPCICRbit(pin));
+    PCICR |= _BV(digitalPinToPCICRbit(pin));
+}
+#else
+void enable_pin_change_interrupt(uint8_t pin) {
+    attachInterrupt(digitalPinToInterrupt(pin), encoders_ISR, CHANGE);
+}
+#endif
+#else
 void left_motor_encoder_ISR(void) { left_motor_encoder.tick_isr(); };
 void right_motor_encoder_ISR(void) { right_motor_encoder.tick_isr(); };
+#endif
+
+#if CONTROL_LOOP_TIMER_ISR
+void control_loop_ISR(void) { motor_controller.control_isr(); }
+#endif
 
 void setup_interrupts(void) {
+#if ENCODER_QUADRATURE_4X
+    left_motor_encoder.reset();
+    right_motor_encoder.reset();
+    enable_pin_change_interrupt(GPIO_MOTOR_LEFT_ENCODER_A);
+    enable_pin_change_interrupt(GPIO_MOTOR_LEFT_ENCODER_B);
+    enable_pin_change_interrupt(GPIO_MOTOR_RIGHT_ENCODER_A);
+    enable_pin_change_interrupt(GPIO_MOTOR_RIGHT_ENCODER_B);
+#else
     attachInterrupt(digitalPinToInterrupt(GPIO_MOTOR_LEFT_ENCODER_A),
                     left_motor_encoder_ISR,
                     RISING);
     attachInterrupt(digitalPinToInterrupt(GPIO_MOTOR_RIGHT_ENCODER_A),
                     right_motor_encoder_ISR,
                     RISING);
+#endif
+#if CONTROL_LOOP_TIMER_ISR
+    ControlTimer::begin(MOTOR_RUN_FREQUENCY, control_loop_ISR);
+#endif
+}
+
+// Tasks of the scheduler, by priority. In CONTROL_LOOP_TIMER_ISR mode the velocity
+// loop runs from the timer interrupt instead.
+void velocity_task(void) { motor_controller.update_velocity(); }
+void odometry_task(void) { motor_controller.update_odometry(); }
+void telemetry_task(void) { serial_protocol.stream_telemetry(); }
+
+void setup_tasks(void) {
+#if !CONTROL_LOOP_TIMER_ISR
+    TaskScheduler::add_task(velocity_task, hz_to_us(MOTOR_RUN_FREQUENCY));
+#endif
+    // Odometry is released with the velocity loop, and runs right after it on fresh
+    // distances. Telemetry is shifted by half a velocity period to spread the load.
+    TaskScheduler::add_task(odometry_task, hz_to_us(ODOMETRY_FREQUENCY));
+    TaskScheduler::add_task(telemetry_task,
+                            hz_to_us(TELEMETRY_FREQUENCY),
+                            hz_to_us(MOTOR_RUN_FREQUENCY) / 2);
 }
 
 CmdVel cmd_vel = {0.3, 1.0};
@@ -43,7 +120,15 @@ CmdVel cmd_vel = {0.3, 1.0};
  */
 void setup(void) {
     Serial.begin(9600);
+
+    // Parameters saved with the `w` command override the compile-time defaults.
+    Parameters params;
+    if (ParameterStore::load(params)) {
+        motor_controller.set_parameters(params);
+    }
+
     setup_interrupts();
+    setup_tasks();
     /* motor_controller.set_cmd_vel(cmd_vel); */
 }
 
@@ -51,6 +136,7 @@ void setup(void) {
  * The loop function is called in an endless loop
  */
 void loop(void) {
-    motor_controller.run();
+    PROFILE_LOOP_PASS();
+    TaskScheduler::run();
     serial_protocol.read_serial();
 }
@@ -2,39 +2,337 @@
 #include "motor_controller.hpp"
 
 #include "configuration.hpp"
+#include "fast_trig.hpp"
+#include "fixed_point.hpp"
+#include "profiler.hpp"
 #include "utils.hpp"
 
-MotorController::MotorController(MotorDriver *left_motor,
-                                 MotorDriver *right_motor,
-                                 float dist_between_wheels)
-    : dist_between_wheels_(dist_between_wheels),
-      left_motor_(left_motor),
-      right_motor_(right_motor),
-      motor_update_timer_(hz_to_ms(MOTOR_RUN_FREQUENCY)) {
+/**
+ * @brief Combine the states of the wheel experiments: RUNNING while any runs,
+ * FAILED if any failed.
+ */
+static AutotuneState combine_autotune_states(RelayAutotuner *tuners, uint8_t count) {
+    AutotuneState state = AutotuneState::IDLE;
+    for (uint8_t i = 0; i < count; i++) {
+        AutotuneState wheel_state = tuners[i].get_state();
+        if (wheel_state == AutotuneState::RUNNING) {
+            return AutotuneState::RUNNING;
+        }
+        if (i == 0 || wheel_state == AutotuneState::FAILED) {
+            state = wheel_state;
+        }
+    }
+    return state;
+}
+
+/**
+ * @brief Check that the PID gains are all finite.
+ */
+static bool is_finite(const pid_gains_t &gains) {
+    return is_finite(gains.kp) && is_finite(gains.ki) && is_finite(gains.kd);
+}
+
+MotorController::MotorController(MotorDriver *motors,
+                                 const WheelSide *sides,
+                                 uint8_t wheel_count,
+                                 const Geometry &geometry,
+                                 const Kinematics &kinematics)
+    : linear_profile_(CMD_VEL_MAX_LINEAR_ACCELERATION, CMD_VEL_MAX_LINEAR_JERK),
+      angular_profile_(CMD_VEL_MAX_ANGULAR_ACCELERATION, CMD_VEL_MAX_ANGULAR_JERK),
+      kinematics_(kinematics),
+      linear_move_(POSITION_MAX_LINEAR_VELOCITY, POSITION_MAX_LINEAR_ACCELERATION),
+      angular_move_(POSITION_MAX_ANGULAR_VELOCITY, POSITION_MAX_ANGULAR_ACCELERATION),
+      motors_(motors) {
+    wheel_count_ = wheel_count < MAX_WHEELS ? wheel_count : MAX_WHEELS;
+    side_count_[SIDE_LEFT] = 0;
+    side_count_[SIDE_RIGHT] = 0;
+    has_encoders_ = wheel_count_ > 0;
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        sides_[i] = sides[i];
+        side_count_[sides[i]]++;
+        encoders_[i] = motors_[i].get_encoder();
+        has_encoders_ = has_encoders_ && encoders_[i] != nullptr;
+    }
+    for (uint8_t side = SIDE_LEFT; side <= SIDE_RIGHT; side++) {
+        side_scale_[side] = side_count_[side] > 0 ? 1.0 / side_count_[side] : 0.0;
+        prev_side_dist_[side] = 0.0;
+    }
     pose_ = {0.0, 0.0, 0.0};
     cmd_vel_ = {0.0, 0.0};
+    tick_count_ = 0;
+    tick_time_ = 0;
+    setpoint_index_ = 0;
+    setpoint_pending_ = false;
+    state_seq_ = 0;
+    last_update_us_ = 0;
+    period_min_ = UINT32_MAX;
+    period_max_ = 0;
+    period_sum_ = 0;
+    period_count_ = 0;
+    tuning_rule_ = RULE_ZIEGLER_NICHOLS;
+    autotuning_ = false;
+    move_start_[SIDE_LEFT] = 0.0;
+    move_start_[SIDE_RIGHT] = 0.0;
+    move_settle_ticks_ = 0;
+    move_state_ = MOVE_IDLE;
+    move_status_ = {MOVE_IDLE, 0.0, 0.0};
+    move_event_ = false;
+    apply_geometry_(geometry);
+#if FIXED_POINT_ODOMETRY
+    reset_pose();
+#endif
 }
 
-void MotorController::set_cmd_vel(CmdVel cmd_vel) { 
-    cmd_vel_ = cmd_vel; 
-    compute_wheel_speeds_();
+uint8_t MotorController::get_wheel_count() { return wheel_count_; }
+
+bool MotorController::set_cmd_vel(CmdVel cmd_vel) {
+    if (isnan(cmd_vel.x) || isinf(cmd_vel.x) || isnan(cmd_vel.w) || isinf(cmd_vel.w)) {
+        return false;
+    }
+    Setpoint setpoint = {cmd_vel, 0, 0, false};
+    post_setpoint_(setpoint);
+    return true;
 }
 
-void MotorController::get_pose(Pose &pose) { pose = pose_; }
+void MotorController::get_pose(Pose &pose) {
+    uint8_t seq;
+    do {
+        seq = state_seq_;
+        compiler_barrier();
+        pose = pose_;
+        compiler_barrier();
+    } while (seq != state_seq_);
+}
 
 void MotorController::reset() {
-    left_motor_->reset();
-    right_motor_->reset();
-    pose_ = {0.0, 0.0, 0.0};
+    reset_pose();
+    lock_();
     cmd_vel_ = {0.0, 0.0};
+    linear_profile_.reset();
+    angular_profile_.reset();
+    setpoint_pending_ = false;
+    cancel_autotune_();
+    end_move_(MOVE_CANCELLED);
+    unlock_();
 }
 
-void MotorController::run() {
-    if (motor_update_timer_.has_elapsed()) {
-        compute_pose_();
-        left_motor_->run();
-        right_motor_->run();
+void MotorController::update_velocity() {
+#if !CONTROL_LOOP_TIMER_ISR
+    update_velocity_();
+#endif
+}
+
+void MotorController::update_odometry() {
+    PROFILE_SCOPE(PROFILE_ODOMETRY);
+    compute_pose_();
+}
+
+void MotorController::control_isr() {
+    if (setpoint_pending_) {
+        apply_setpoint_(setpoints_[setpoint_index_]);
+        setpoint_pending_ = false;
     }
+    update_velocity_();
+}
+
+void MotorController::update_velocity_() {
+    PROFILE_SCOPE(PROFILE_VELOCITY_LOOP);
+    state_seq_++;
+
+    unsigned long now_us = micros();
+    if (last_update_us_ != 0) {
+        uint32_t period = now_us - last_update_us_;
+        if (period < period_min_) period_min_ = period;
+        if (period > period_max_) period_max_ = period;
+        period_sum_ += period;
+        period_count_++;
+    }
+    last_update_us_ = now_us;
+
+    tick_count_++;
+    tick_time_ = millis();
+
+    if (move_state_ == MOVE_RUNNING) {
+        update_move_();
+    } else if (!linear_profile_.is_settled() || !angular_profile_.is_settled()) {
+        const float dt = 1.0 / MOTOR_RUN_FREQUENCY;
+        cmd_vel_.x = linear_profile_.update(dt);
+        cmd_vel_.w = angular_profile_.update(dt);
+        compute_wheel_speeds_(linear_profile_.get_acceleration(),
+                              angular_profile_.get_acceleration());
+    }
+
+    if (has_encoders_) {
+        // All the wheels and the odometry use one coherent sample.
+        EncoderSample samples[MAX_WHEELS];
+        unsigned long time = Encoder::sample_all(encoders_, samples, wheel_count_);
+        for (uint8_t i = 0; i < wheel_count_; i++) {
+            motors_[i].run(samples[i], time);
+        }
+        if (autotuning_) {
+            update_autotune_(time);
+        }
+    } else {
+        for (uint8_t i = 0; i < wheel_count_; i++) {
+            motors_[i].run();
+        }
+    }
+
+    if (recorder_.tick()) {
+        WheelSample wheels[MAX_WHEELS] = {};
+        for (uint8_t i = 0; i < wheel_count_; i++) {
+            motors_[i].get_sample(wheels[i]);
+        }
+        recorder_.record(wheels);
+    }
+
+    state_seq_++;
+}
+
+void MotorController::apply_setpoint_(const Setpoint &setpoint) {
+    cancel_autotune_();
+    end_move_(MOVE_CANCELLED);
+    recorder_.trigger();
+    if (setpoint.open_loop) {
+        cmd_vel_ = {0.0, 0.0};
+        linear_profile_.reset();
+        angular_profile_.reset();
+        for (uint8_t i = 0; i < wheel_count_; i++) {
+            motors_[i].set_pwm(sides_[i] == SIDE_RIGHT ? setpoint.right_pwm
+                                                       : setpoint.left_pwm);
+        }
+        return;
+    }
+    // Ramped from the current profiled velocity by the next updates.
+    linear_profile_.set_target(setpoint.cmd_vel.x);
+    angular_profile_.set_target(setpoint.cmd_vel.w);
+    compute_wheel_speeds_(linear_profile_.get_acceleration(),
+                          angular_profile_.get_acceleration());
+}
+
+void MotorController::post_setpoint_(const Setpoint &setpoint) {
+#if CONTROL_LOOP_TIMER_ISR
+    // Write the buffer the interrupt is not reading, then publish it.
+    uint8_t index = setpoint_index_ ^ 1;
+    setpoints_[index] = setpoint;
+    compiler_barrier();
+    setpoint_index_ = index;
+    setpoint_pending_ = true;
+#else
+    apply_setpoint_(setpoint);
+#endif
+}
+
+void MotorController::update_autotune_(unsigned long time) {
+    // The relay reacts to this sample, sent now rather than on the next update.
+    MotorData motor_data;
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        motors_[i].get_motor_data(motor_data);
+        motors_[i].set_pwm(tuners_[i].update(motor_data.velocity, time));
+        motors_[i].send_pwm();
+    }
+
+    AutotuneState state = combine_autotune_states(tuners_, wheel_count_);
+    if (state == AutotuneState::RUNNING) {
+        return;
+    }
+    autotuning_ = false;
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        motors_[i].set_pwm(0);
+        motors_[i].send_pwm();
+        if (state == AutotuneState::DONE) {
+            AutotuneResult result;
+            tuners_[i].get_result(result);
+            motors_[i].update_motor_pid(RelayAutotuner::compute_gains(
+                result.ultimate_gain, result.ultimate_period, tuning_rule_));
+        }
+    }
+}
+
+void MotorController::cancel_autotune_() {
+    if (!autotuning_) {
+        return;
+    }
+    autotuning_ = false;
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        tuners_[i].cancel();
+    }
+}
+
+void MotorController::update_move_() {
+    const float dt = 1.0 / MOTOR_RUN_FREQUENCY;
+    linear_move_.update(dt);
+    angular_move_.update(dt);
+
+    // The distances are those of the previous control tick.
+    float distance, angle;
+    get_move_progress_(distance, angle);
+    float distance_error = linear_move_.get_position() - distance;
+    float angle_error = angular_move_.get_position() - angle;
+    cmd_vel_.x = linear_move_.get_velocity() + POSITION_KP_LINEAR * distance_error;
+    cmd_vel_.w = angular_move_.get_velocity() + POSITION_KP_ANGULAR * angle_error;
+    compute_wheel_speeds_(linear_move_.get_acceleration(),
+                          angular_move_.get_acceleration());
+
+    if (!linear_move_.is_done() || !angular_move_.is_done()) {
+        return;
+    }
+    if (fabs(distance_error) <= POSITION_TOLERANCE_LINEAR &&
+        fabs(angle_error) <= POSITION_TOLERANCE_ANGULAR) {
+        end_move_(MOVE_REACHED);
+    } else if (++move_settle_ticks_ >=
+               uint32_t(POSITION_SETTLE_TIMEOUT_MS) * MOTOR_RUN_FREQUENCY / 1000) {
+        end_move_(MOVE_TIMEOUT);
+    }
+}
+
+void MotorController::end_move_(MoveState state) {
+    if (move_state_ != MOVE_RUNNING) {
+        return;
+    }
+    move_state_ = state;
+    move_status_.state = state;
+    get_move_progress_(move_status_.distance, move_status_.angle);
+    move_event_ = true;
+    if (state != MOVE_CANCELLED) {
+        cmd_vel_ = {0.0, 0.0};
+        compute_wheel_speeds_(0.0, 0.0);
+    }
+    linear_profile_.reset(cmd_vel_.x);
+    angular_profile_.reset(cmd_vel_.w);
+}
+
+void MotorController::get_side_distances_(float *side_dist) {
+    side_dist[SIDE_LEFT] = 0.0;
+    side_dist[SIDE_RIGHT] = 0.0;
+    MotorData motor_data;
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        motors_[i].get_motor_data(motor_data);
+        side_dist[sides_[i]] += motor_data.distance;
+    }
+}
+
+void MotorController::get_move_progress_(float &distance, float &angle) {
+    float side_dist[2];
+    get_side_distances_(side_dist);
+    float d_l =
+        (side_dist[SIDE_LEFT] - move_start_[SIDE_LEFT]) * side_scale_[SIDE_LEFT];
+    float d_r =
+        (side_dist[SIDE_RIGHT] - move_start_[SIDE_RIGHT]) * side_scale_[SIDE_RIGHT];
+    distance = (d_l + d_r) * 0.5;
+    angle = (d_r - d_l) * inverse_wheel_base_;
+}
+
+void MotorController::lock_() {
+#if CONTROL_LOOP_TIMER_ISR
+    noInterrupts();
+#endif
+}
+
+void MotorController::unlock_() {
+#if CONTROL_LOOP_TIMER_ISR
+    interrupts();
+#endif
 }
 
 void MotorController::move_forward() {
@@ -59,47 +357,114 @@ void MotorController::stop() {
 }
 
 void MotorController::reset_pose() {
+    lock_();
+    // The move is measured from the wheel distances reset below.
+    end_move_(MOVE_CANCELLED);
     pose_ = {0.0, 0.0, 0.0};
-    left_motor_->reset();
-    right_motor_->reset();
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        motors_[i].reset();
+    }
+    for (uint8_t side = SIDE_LEFT; side <= SIDE_RIGHT; side++) {
+        prev_side_dist_[side] = 0.0;
+#if FIXED_POINT_ODOMETRY
+        prev_side_dist_q16_[side] = 0;
+        side_remainder_q16_[side] = 0;
+#endif
+    }
+#if FIXED_POINT_ODOMETRY
+    pose_x_q16_ = 0;
+    pose_y_q16_ = 0;
+    heading_ = 0;
+#endif
+    unlock_();
+}
+
+void MotorController::compute_wheel_speeds_(float accel_x, float accel_w) {
+    // Linear wheel velocities of each side, as expected by the motor drivers.
+    float velocity[2];
+    velocity[SIDE_LEFT] = cmd_vel_.x - cmd_vel_.w * half_wheel_base_;
+    velocity[SIDE_RIGHT] = cmd_vel_.x + cmd_vel_.w * half_wheel_base_;
+
+    // Same kinematics for the planned accelerations, used as feed-forward.
+    float acceleration[2];
+    acceleration[SIDE_LEFT] = accel_x - accel_w * half_wheel_base_;
+    acceleration[SIDE_RIGHT] = accel_x + accel_w * half_wheel_base_;
+
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        motors_[i].set_velocity(velocity[sides_[i]], acceleration[sides_[i]]);
+    }
 }
 
-void MotorController::compute_wheel_speeds_() {
-    float v_r = (2 * cmd_vel_.x + cmd_vel_.w * dist_between_wheels_) /
-                (2 * right_motor_->get_wheel_radius());
-    float v_l = (2 * cmd_vel_.x - cmd_vel_.w * dist_between_wheels_) /
-                (2 * right_motor_->get_wheel_radius());
+#if FIXED_POINT_ODOMETRY
+
+void MotorController::compute_pose_() {
+    int32_t side_dist[2] = {0, 0};
+    lock_();
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        side_dist[sides_[i]] += motors_[i].get_distance_q16();
+    }
+    unlock_();
 
-    // Downscale velocity for motor max velocity
-    v_r = v_r * 0.0338;
-    v_l = v_l * 0.0338;
+    // Mean distance travelled by the wheels of each side. The remainder of the
+    // division is carried over, so that no distance is lost to rounding.
+    int32_t d[2];
+    for (uint8_t side = SIDE_LEFT; side <= SIDE_RIGHT; side++) {
+        int32_t delta =
+            side_dist[side] - prev_side_dist_q16_[side] + side_remainder_q16_[side];
+        d[side] = side_count_[side] > 1 ? delta / side_count_[side] : delta;
+        side_remainder_q16_[side] = delta - d[side] * side_count_[side];
+        prev_side_dist_q16_[side] = side_dist[side];
+    }
+    int32_t d_l = d[SIDE_LEFT];
+    int32_t d_r = d[SIDE_RIGHT];
 
-    right_motor_->set_velocity(v_r);
-    left_motor_->set_velocity(v_l);
+    // d_c * cos(theta) with d_c = (d_l + d_r) / 2, folded in the shift.
+    int32_t d_sum = d_l + d_r;
+    pose_x_q16_ += (d_sum * fixed_cos(heading_) + (1L << 15)) >> 16;
+    pose_y_q16_ += (d_sum * fixed_sin(heading_) + (1L << 15)) >> 16;
+    heading_ += uint32_t((d_r - d_l) * heading_scale_);
+
+    pose_.x = q16_to_float(pose_x_q16_);
+    pose_.y = q16_to_float(pose_y_q16_);
+    pose_.theta = binary_angle_to_rad(heading_);
 }
 
+#else
+
 void MotorController::compute_pose_() {
-    MotorData left_motor_data;
-    MotorData right_motor_data;
-    left_motor_->get_motor_data(left_motor_data);
-    right_motor_->get_motor_data(right_motor_data);
+    float side_dist[2];
+    lock_();
+    get_side_distances_(side_dist);
+    unlock_();
 
-    float d_l = left_motor_data.distance - prev_left_dist_;
-    float d_r = right_motor_data.distance - prev_right_dist_;
-    float d_c = (d_l + d_r) / 2.0;
-    float d_theta = (d_r - d_l) / dist_between_wheels_;
+    // Mean distance travelled by the wheels of each side.
+    float d_l =
+        (side_dist[SIDE_LEFT] - prev_side_dist_[SIDE_LEFT]) * side_scale_[SIDE_LEFT];
+    float d_r =
+        (side_dist[SIDE_RIGHT] - prev_side_dist_[SIDE_RIGHT]) * side_scale_[SIDE_RIGHT];
+    float d_c = (d_l + d_r) * 0.5;
+    float d_theta = (d_r - d_l) * inverse_wheel_base_;
 
     // Update the pose
+#if ODOMETRY_TRIG_TABLE
+    float sin_theta, cos_theta;
+    fast_sincos(pose_.theta, sin_theta, cos_theta);
+    pose_.x += d_c * cos_theta;
+    pose_.y += d_c * sin_theta;
+#else
     pose_.x += d_c * cos(pose_.theta);
     pose_.y += d_c * sin(pose_.theta);
+#endif
     pose_.theta += d_theta;
     if (pose_.theta > PI) pose_.theta -= 2 * PI;
     if (pose_.theta < -PI) pose_.theta += 2 * PI;
 
-    prev_left_dist_ = left_motor_data.distance;
-    prev_right_dist_ = right_motor_data.distance;
+    prev_side_dist_[SIDE_LEFT] = side_dist[SIDE_LEFT];
+    prev_side_dist_[SIDE_RIGHT] = side_dist[SIDE_RIGHT];
 }
 
+#endif
+
 void MotorController::print_pose() {
     Serial.print("Pose: ");
     Serial.print(pose_.x);
@@ -110,18 +475,272 @@ void MotorController::print_pose() {
 }
 
 void MotorController::move_open_loop(uint8_t left_pwm, uint8_t right_pwm) {
-    left_motor_->set_pwm(left_pwm);
-    right_motor_->set_pwm(right_pwm);
+    Setpoint setpoint = {{0.0, 0.0}, left_pwm, right_pwm, true};
+    post_setpoint_(setpoint);
+}
+
+void MotorController::get_motor_status(MotorData *motors) {
+    uint8_t seq;
+    do {
+        seq = state_seq_;
+        compiler_barrier();
+        for (uint8_t i = 0; i < wheel_count_; i++) {
+            motors_[i].get_motor_data(motors[i]);
+        }
+        compiler_barrier();
+    } while (seq != state_seq_);
+}
+
+bool MotorController::update_motor_pids(pid_gains_t pid_gains) {
+    if (!is_finite(pid_gains)) {
+        return false;
+    }
+    lock_();
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        motors_[i].update_motor_pid(pid_gains);
+    }
+    unlock_();
+    return true;
 }
 
-void MotorController::get_motor_status(MotorData &left_motor, MotorData &right_motor) {
-    left_motor_->get_motor_data(left_motor);
-    right_motor_->get_motor_data(right_motor);
+pid_gains_t MotorController::get_motor_pids() { return get_motor_pids(0); }
+
+pid_gains_t MotorController::get_motor_pids(uint8_t wheel) {
+    lock_();
+    pid_gains_t pid_gains = motors_[wheel].get_motor_pid();
+    unlock_();
+    return pid_gains;
 }
 
-void MotorController::update_motor_pids(pid_gains_t pid_gains) {
-    left_motor_->update_motor_pid(pid_gains);
-    right_motor_->update_motor_pid(pid_gains);
+bool MotorController::set_gain_breakpoint(uint8_t wheel,
+                                          uint8_t index,
+                                          const GainBreakpoint &breakpoint) {
+    if (wheel >= wheel_count_ || !is_finite(breakpoint.velocity) ||
+        !is_finite(breakpoint.gains)) {
+        return false;
+    }
+    lock_();
+    bool success = motors_[wheel].set_gain_breakpoint(index, breakpoint);
+    unlock_();
+    return success;
+}
+
+uint8_t MotorController::get_gain_schedule(uint8_t wheel, GainBreakpoint *breakpoints) {
+    if (wheel >= wheel_count_) {
+        return 0;
+    }
+    lock_();
+    uint8_t size = motors_[wheel].get_gain_schedule(breakpoints);
+    unlock_();
+    return size;
+}
+
+bool MotorController::set_geometry(const Geometry &geometry) {
+    if (!geometry.is_valid()) {
+        return false;
+    }
+    lock_();
+    apply_geometry_(geometry);
+    unlock_();
+    reset_pose();
+    return true;
+}
+
+void MotorController::get_geometry(Geometry &geometry) {
+    lock_();
+    geometry = geometry_;
+    unlock_();
+}
+
+void MotorController::apply_geometry_(const Geometry &geometry) {
+    geometry_ = geometry;
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        motors_[i].set_geometry(geometry.wheel_radius, geometry.counts_per_rev());
+    }
+    float wheel_base = kinematics_.wheel_base(geometry);
+    half_wheel_base_ = wheel_base * 0.5;
+    inverse_wheel_base_ = 1.0 / wheel_base;
+#if FIXED_POINT_ODOMETRY
+    heading_scale_ = float_to_fixed(inverse_wheel_base_ / (2 * PI), 16);
+#endif
+}
+
+void MotorController::get_parameters(Parameters &params) {
+    // Unused breakpoints are zeroed, so that they compare equal across saves.
+    memset(&params, 0, sizeof(params));
+    get_geometry(params.geometry);
+    lock_();
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        params.feedforward[i] = motors_[i].get_feedforward_gains();
+        params.gain_schedule_size[i] =
+            motors_[i].get_gain_schedule(params.gain_schedule[i]);
+    }
+    unlock_();
+}
+
+void MotorController::set_parameters(const Parameters &params) {
+    set_geometry(params.geometry);
+    lock_();
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        motors_[i].set_feedforward_gains(params.feedforward[i]);
+        motors_[i].set_gain_schedule(params.gain_schedule[i],
+                                     params.gain_schedule_size[i]);
+    }
+    unlock_();
+}
+
+bool MotorController::update_feedforward_gains(FeedForwardGains gains) {
+    if (!is_finite(gains.ks) || !is_finite(gains.kv) || !is_finite(gains.ka)) {
+        return false;
+    }
+    lock_();
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        motors_[i].set_feedforward_gains(gains);
+    }
+    unlock_();
+    return true;
 }
 
-pid_gains_t MotorController::get_motor_pids() { return left_motor_->get_motor_pid(); }
+FeedForwardGains MotorController::get_feedforward_gains() {
+    lock_();
+    FeedForwardGains gains = motors_[0].get_feedforward_gains();
+    unlock_();
+    return gains;
+}
+
+uint32_t MotorController::get_tick_count() {
+    uint8_t seq;
+    uint32_t tick_count;
+    do {
+        seq = state_seq_;
+        compiler_barrier();
+        tick_count = tick_count_;
+        compiler_barrier();
+    } while (seq != state_seq_);
+    return tick_count;
+}
+
+unsigned long MotorController::get_tick_time() {
+    uint8_t seq;
+    unsigned long tick_time;
+    do {
+        seq = state_seq_;
+        compiler_barrier();
+        tick_time = tick_time_;
+        compiler_barrier();
+    } while (seq != state_seq_);
+    return tick_time;
+}
+
+uint32_t MotorController::get_encoder_error_count() {
+    uint32_t errors = 0;
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        errors += motors_[i].get_encoder_error_count();
+    }
+    return errors;
+}
+
+void MotorController::get_loop_timing(LoopTiming &timing) {
+    lock_();
+    timing.min_period = period_count_ ? period_min_ : 0;
+    timing.max_period = period_max_;
+    timing.mean_period = period_count_ ? period_sum_ / period_count_ : 0;
+    timing.count = period_count_;
+    period_min_ = UINT32_MAX;
+    period_max_ = 0;
+    period_sum_ = 0;
+    period_count_ = 0;
+    unlock_();
+}
+
+bool MotorController::start_recording(uint8_t trigger, uint8_t divider) {
+    if (trigger > TRIGGER_SETPOINT || divider == 0) {
+        return false;
+    }
+    lock_();
+    recorder_.arm(RecorderTrigger(trigger), divider);
+    unlock_();
+    return true;
+}
+
+void MotorController::get_recorder_status(RecorderStatus &status) {
+    lock_();
+    recorder_.get_status(status);
+    unlock_();
+}
+
+bool MotorController::get_record(uint8_t index, WheelSample *wheels) {
+    lock_();
+    bool found = recorder_.get_record(index, wheels);
+    unlock_();
+    return found;
+}
+
+bool MotorController::start_move(float distance, float angle) {
+    if (!has_encoders_ || isnan(distance) || isinf(distance) || isnan(angle) ||
+        isinf(angle)) {
+        return false;
+    }
+
+    lock_();
+    setpoint_pending_ = false;
+    cancel_autotune_();
+    end_move_(MOVE_CANCELLED);
+    recorder_.trigger();
+    get_side_distances_(move_start_);
+    linear_move_.start(distance);
+    angular_move_.start(angle);
+    move_settle_ticks_ = 0;
+    move_state_ = MOVE_RUNNING;
+    unlock_();
+    return true;
+}
+
+bool MotorController::get_move_event(MoveStatus &status) {
+    lock_();
+    bool ended = move_event_;
+    status = move_status_;
+    move_event_ = false;
+    unlock_();
+    return ended;
+}
+
+bool MotorController::start_autotune(float setpoint, uint8_t amplitude, uint8_t rule) {
+    if (!has_encoders_ || isnan(setpoint) || setpoint <= 0.0 ||
+        setpoint > MOTOR_MAX_VELOCITY || amplitude == 0 || rule > RULE_NO_OVERSHOOT) {
+        return false;
+    }
+
+    lock_();
+    cmd_vel_ = {0.0, 0.0};
+    linear_profile_.reset();
+    angular_profile_.reset();
+    setpoint_pending_ = false;
+    end_move_(MOVE_CANCELLED);
+    unsigned long now = micros();
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        // Start from the feed-forward model, or from a relay that never reverses.
+        FeedForwardGains ff = motors_[i].get_feedforward_gains();
+        float bias = ff.kv > 0.0 ? ff.ks + ff.kv * setpoint : amplitude;
+        tuners_[i].start(setpoint, amplitude, bias, now);
+    }
+    tuning_rule_ = TuningRule(rule);
+    autotuning_ = true;
+    unlock_();
+    return true;
+}
+
+AutotuneState MotorController::get_autotune_state() {
+    lock_();
+    AutotuneState state = combine_autotune_states(tuners_, wheel_count_);
+    unlock_();
+    return state;
+}
+
+void MotorController::get_autotune_result(AutotuneResult *results) {
+    lock_();
+    for (uint8_t i = 0; i < wheel_count_; i++) {
+        tuners_[i].get_result(results[i]);
+    }
+    unlock_();
+}
@@ -1,6 +1,8 @@
 #include "motor_driver.hpp"
 
 #include "configuration.hpp"
+#include "fixed_point.hpp"
+#include "profiler.hpp"
 #include "utils.hpp"
 
 MotorDriver::MotorDriver(uint8_t pin_en, uint8_t pin_in1, uint8_t pin_in2, bool reverse)
@@ -10,6 +12,10 @@ MotorDriver::MotorDriver(uint8_t pin_en, uint8_t pin_in1, uint8_t pin_in2, bool
       reverse_(reverse),
       pid_(MOTOR_DRIVER_PID_KP, MOTOR_DRIVER_PID_KI, MOTOR_DRIVER_PID_KD) {
     pid_.set_output_limits(-255, 255);
+    update_motor_pid({MOTOR_DRIVER_PID_KP, MOTOR_DRIVER_PID_KI, MOTOR_DRIVER_PID_KD});
+    velocity_setpoint_ = 0.0;
+    acceleration_ = 0.0;
+    feedforward_ = {MOTOR_DRIVER_FF_KS, MOTOR_DRIVER_FF_KV, MOTOR_DRIVER_FF_KA};
     init_pins_();
     motor_mode_ = MotorMode::OPEN_LOOP;
 }
@@ -24,23 +30,36 @@ MotorDriver::MotorDriver(uint8_t pin_en,
     : pin_en_(pin_en),
       pin_in1_(pin_in1),
       pin_in2_(pin_in2_),
-      wheel_radius_(wheel_radius),
-      ticks_per_rev_(ticks_per_rev),
       reverse_(reverse),
       encoder_(encoder),
       pid_(MOTOR_DRIVER_PID_KP, MOTOR_DRIVER_PID_KI, MOTOR_DRIVER_PID_KD) {
     pid_.set_output_limits(-255, 255);
+    update_motor_pid({MOTOR_DRIVER_PID_KP, MOTOR_DRIVER_PID_KI, MOTOR_DRIVER_PID_KD});
+    velocity_setpoint_ = 0.0;
+    acceleration_ = 0.0;
+    feedforward_ = {MOTOR_DRIVER_FF_KS, MOTOR_DRIVER_FF_KV, MOTOR_DRIVER_FF_KA};
     init_pins_();
     motor_mode_ = MotorMode::CLOSED_LOOP;
+    set_geometry(wheel_radius, ticks_per_rev);
     encoder_->reset();
-    last_encoder_reading_ = encoder_->get_ticks();
-    last_data_reading_time_ = millis();
+    EncoderSample sample;
+    encoder_->sample(sample);
+    last_encoder_reading_ = sample.ticks;
+    last_edge_time_ = sample.edge_time;
+    last_data_reading_time_ = micros();
+    tick_rate_ = 0;
+    tick_delta_ = 0;
+#if FIXED_POINT_ODOMETRY
+    distance_q16_ = 0;
+    distance_residual_ = 0;
+#endif
 }
 
 void MotorDriver::init_pins_(void) {
     pinMode(pin_en_, OUTPUT);
     pinMode(pin_in1_, OUTPUT);
     pinMode(pin_in2_, OUTPUT);
+    motor_dir_ = MotorDirection::STOP;
 }
 
 void MotorDriver::reset() {
@@ -48,10 +67,21 @@ void MotorDriver::reset() {
         return;
     }
     encoder_->reset();
-    last_encoder_reading_ = encoder_->get_ticks();
-    last_data_reading_time_ = millis();
+    EncoderSample sample;
+    encoder_->sample(sample);
+    last_encoder_reading_ = sample.ticks;
+    last_edge_time_ = sample.edge_time;
+    last_data_reading_time_ = micros();
+    tick_rate_ = 0;
+    tick_delta_ = 0;
     set_pwm(0);
     pid_.reset();
+    velocity_setpoint_ = 0.0;
+    acceleration_ = 0.0;
+#if FIXED_POINT_ODOMETRY
+    distance_q16_ = 0;
+    distance_residual_ = 0;
+#endif
 }
 
 void MotorDriver::set_pwm(int pwm, MotorMode mode) {
@@ -74,6 +104,7 @@ void MotorDriver::set_pwm(int pwm, MotorMode mode) {
 void MotorDriver::set_direction(MotorDirection dir) {
     byte in1 = reverse_ ^ (dir == MotorDirection::CW);
     byte in2 = reverse_ ^ (dir == MotorDirection::CCW);
+    motor_dir_ = dir;
 
     switch (dir) {
         case MotorDirection::CW:
@@ -99,13 +130,15 @@ void MotorDriver::set_mode(MotorMode mode) {
     motor_mode_ = mode;
 }
 
-void MotorDriver::set_velocity(float velocity) {
+void MotorDriver::set_velocity(float velocity, float acceleration) {
     bound(velocity, -MOTOR_MAX_VELOCITY, MOTOR_MAX_VELOCITY);
     if (encoder_ == nullptr) {
         return;
     }
     motor_mode_ = MotorMode::CLOSED_LOOP;
     pid_.set_setpoint(velocity);
+    velocity_setpoint_ = velocity;
+    acceleration_ = acceleration;
 }
 
 void MotorDriver::get_motor_data(MotorData &motor_data) { motor_data = motor_data_; }
@@ -114,19 +147,147 @@ float MotorDriver::get_wheel_radius() { return wheel_radius_; }
 
 uint16_t MotorDriver::get_ticks_per_rev() { return ticks_per_rev_; }
 
+void MotorDriver::set_geometry(float wheel_radius, uint16_t ticks_per_rev) {
+    wheel_radius_ = wheel_radius;
+    ticks_per_rev_ = ticks_per_rev;
+    meters_per_tick_ = 2 * PI * wheel_radius_ / ticks_per_rev_;
+    rpm_per_tick_rate_ = (60.0 / 16.0) / ticks_per_rev_;
+#if FIXED_POINT_ODOMETRY
+    init_fixed_point_scales_();
+#endif
+}
+
+uint16_t MotorDriver::get_encoder_error_count() {
+    return encoder_ == nullptr ? 0 : encoder_->get_error_count();
+}
+
 void MotorDriver::update_motor_pid(pid_gains_t pid_gains) {
+    gain_schedule_[0].velocity = 0.0;
+    gain_schedule_[0].gains = pid_gains;
+    gain_schedule_size_ = 1;
     pid_.set_pid_gains(pid_gains);
 }
 
+bool MotorDriver::set_gain_breakpoint(uint8_t index, const GainBreakpoint &breakpoint) {
+    if (index >= PID_GAIN_SCHEDULE_SIZE || index > gain_schedule_size_ ||
+        breakpoint.velocity < 0.0) {
+        return false;
+    }
+    // Keep the velocities strictly increasing.
+    if (index > 0 && breakpoint.velocity <= gain_schedule_[index - 1].velocity) {
+        return false;
+    }
+    if (index + 1 < gain_schedule_size_ &&
+        breakpoint.velocity >= gain_schedule_[index + 1].velocity) {
+        return false;
+    }
+    gain_schedule_[index] = breakpoint;
+    if (index == gain_schedule_size_) {
+        gain_schedule_size_++;
+    }
+    update_scheduled_gains_();
+    return true;
+}
+
+bool MotorDriver::set_gain_schedule(const GainBreakpoint *breakpoints, uint8_t size) {
+    if (size == 0 || size > PID_GAIN_SCHEDULE_SIZE || breakpoints[0].velocity < 0.0) {
+        return false;
+    }
+    for (uint8_t i = 1; i < size; i++) {
+        if (breakpoints[i].velocity <= breakpoints[i - 1].velocity) {
+            return false;
+        }
+    }
+    for (uint8_t i = 0; i < size; i++) {
+        gain_schedule_[i] = breakpoints[i];
+    }
+    gain_schedule_size_ = size;
+    update_scheduled_gains_();
+    return true;
+}
+
+uint8_t MotorDriver::get_gain_schedule(GainBreakpoint *breakpoints) {
+    for (uint8_t i = 0; i < gain_schedule_size_; i++) {
+        breakpoints[i] = gain_schedule_[i];
+    }
+    return gain_schedule_size_;
+}
+
+void MotorDriver::update_scheduled_gains_(void) {
+    float speed = fabs(velocity_setpoint_);
+    const GainBreakpoint *low = &gain_schedule_[0];
+    if (gain_schedule_size_ == 1 || speed <= low->velocity) {
+        pid_.set_pid_gains(low->gains);
+        return;
+    }
+    for (uint8_t i = 1; i < gain_schedule_size_; i++) {
+        const GainBreakpoint *high = &gain_schedule_[i];
+        if (speed < high->velocity) {
+            float t = (speed - low->velocity) / (high->velocity - low->velocity);
+            pid_gains_t gains;
+            gains.kp = low->gains.kp + t * (high->gains.kp - low->gains.kp);
+            gains.ki = low->gains.ki + t * (high->gains.ki - low->gains.ki);
+            gains.kd = low->gains.kd + t * (high->gains.kd - low->gains.kd);
+            pid_.set_pid_gains(gains);
+            return;
+        }
+        low = high;
+    }
+    pid_.set_pid_gains(low->gains);
+}
+
 pid_gains_t MotorDriver::get_motor_pid() { return pid_.get_pid_gains(); }
 
+void MotorDriver::set_feedforward_gains(FeedForwardGains gains) { feedforward_ = gains; }
+
+FeedForwardGains MotorDriver::get_feedforward_gains() { return feedforward_; }
+
+float MotorDriver::compute_feedforward_(void) {
+    if (velocity_setpoint_ == 0.0) {
+        return 0.0;
+    }
+    float pwm = feedforward_.kv * velocity_setpoint_ + feedforward_.ka * acceleration_;
+    return velocity_setpoint_ > 0.0 ? pwm + feedforward_.ks : pwm - feedforward_.ks;
+}
+
 void MotorDriver::send_pwm() { analogWrite(pin_en_, pwm_); }
 
+void MotorDriver::get_sample(WheelSample &sample) {
+    bool closed_loop = motor_mode_ == MotorMode::CLOSED_LOOP;
+    sample.setpoint = closed_loop ? int16_t(velocity_setpoint_ * 1000) : 0;
+    sample.velocity = motor_data_.velocity * 1000;
+    sample.pwm = motor_dir_ == MotorDirection::CCW ? -int16_t(pwm_) : pwm_;
+    int32_t ticks = tick_delta_;
+    sample.ticks = ticks > INT8_MAX ? INT8_MAX : ticks < INT8_MIN ? INT8_MIN : ticks;
+}
+
+Encoder *MotorDriver::get_encoder() { return encoder_; }
+
 void MotorDriver::run() {
+    if (encoder_ == nullptr) {
+        send_pwm();
+        return;
+    }
+    EncoderSample sample;
+    encoder_->sample(sample);
+    run(sample, micros());
+}
+
+void MotorDriver::run(const EncoderSample &sample, unsigned long time) {
+    {
+        PROFILE_SCOPE(PROFILE_MOTOR_DATA);
+        compute_motor_data_(sample, time);
+    }
     if (motor_mode_ == MotorMode::CLOSED_LOOP) {
-        compute_motor_data_();
-        auto error = pid_.compute(motor_data_.velocity);
-        set_pwm(error, MotorMode::CLOSED_LOOP);
+        if (gain_schedule_size_ > 1) {
+            update_scheduled_gains_();
+        }
+        float error;
+        {
+            PROFILE_SCOPE(PROFILE_PID);
+            error = pid_.compute(motor_data_.velocity);
+        }
+        set_pwm(error + compute_feedforward_(), MotorMode::CLOSED_LOOP);
     }
     send_pwm();
 }
@@ -144,31 +305,93 @@ void MotorDriver::print_status(void) {
     Serial.println(pwm_);
 }
 
-float MotorDriver::compute_rpm_(void) {
-    auto ticks = encoder_->get_ticks();
-    auto now = millis();
-    auto dt_time = now - last_data_reading_time_;
-    auto dt_ticks = ticks - last_encoder_reading_;
-    float rpm = (float(dt_ticks) / dt_time) * 60000.0 / ticks_per_rev_;
-    last_encoder_reading_ = ticks;
-    last_data_reading_time_ = now;
-    return rpm;
+int32_t MotorDriver::update_tick_rate_(const EncoderSample &sample,
+                                       unsigned long time) {
+    int32_t dt_ticks = sample.ticks - last_encoder_reading_;
+    uint32_t dt_time = time - last_data_reading_time_;
+
+    const uint32_t timeout_us = VELOCITY_TIMEOUT_MS * 1000UL;
+    if (dt_ticks >= VELOCITY_PERIOD_THRESHOLD_TICKS ||
+        dt_ticks <= -VELOCITY_PERIOD_THRESHOLD_TICKS) {
+        // 16e6 / dt_time, with dt_time in 64us units to stay within 32 bits.
+        int32_t dt_time_64us = dt_time >> 6;
+        tick_rate_ = dt_time_64us > 0 ? dt_ticks * 250000L / dt_time_64us : 0;
+    } else if (dt_ticks != 0) {
+        // The ticks were counted exactly between the two last edges.
+        uint32_t span = sample.edge_time - last_edge_time_;
+        if (span > timeout_us) span = timeout_us;
+        tick_rate_ = span > 0 ? dt_ticks * 16000000L / int32_t(span) : 0;
+    } else {
+        // The wheel is at most as fast as one tick since the last edge.
+        uint32_t elapsed = time - sample.edge_time;
+        if (elapsed >= timeout_us) {
+            tick_rate_ = 0;
+        } else if (elapsed > 0) {
+            int32_t max_rate = 16000000L / int32_t(elapsed);
+            if (tick_rate_ > max_rate) {
+                tick_rate_ = max_rate;
+            } else if (tick_rate_ < -max_rate) {
+                tick_rate_ = -max_rate;
+            }
+        }
+    }
+
+    last_encoder_reading_ = sample.ticks;
+    last_edge_time_ = sample.edge_time;
+    last_data_reading_time_ = time;
+    tick_delta_ = dt_ticks;
+    return dt_ticks;
 }
 
-float MotorDriver::compute_angular_velocity_(float rpm) { return rpm * 2 * PI / 60; }
+float MotorDriver::compute_rpm_(void) { return tick_rate_ * rpm_per_tick_rate_; }
+
+float MotorDriver::compute_angular_velocity_(float rpm) { return rpm * (2 * PI / 60); }
 
 float MotorDriver::compute_velocity_(float angular_velocity) {
     return angular_velocity * wheel_radius_;
 }
 
 float MotorDriver::compute_distance_(void) {
-    auto ticks = encoder_->get_ticks();
-    return ticks * 2 * PI * wheel_radius_ / ticks_per_rev_;
+    return last_encoder_reading_ * meters_per_tick_;
 }
 
-void MotorDriver::compute_motor_data_(void) {
+#if FIXED_POINT_ODOMETRY
+
+void MotorDriver::init_fixed_point_scales_(void) {
+    velocity_scale_ = float_to_fixed(meters_per_tick_, 24);
+    angular_velocity_scale_ = float_to_fixed(2 * PI / ticks_per_rev_, 20);
+    rpm_scale_ = float_to_fixed(60.0 / ticks_per_rev_, 16);
+    distance_scale_ = float_to_fixed(meters_per_tick_, 28);
+}
+
+int32_t MotorDriver::get_distance_q16() { return distance_q16_; }
+
+void MotorDriver::compute_motor_data_(const EncoderSample &sample, unsigned long time) {
+    int32_t dt_ticks = update_tick_rate_(sample, time);
+
+    // Products below stay within 32 bits up to ~8000 ticks/s.
+    int32_t tick_rate = tick_rate_;
+    motor_data_.velocity = q16_to_float((tick_rate * velocity_scale_) >> 12);
+    motor_data_.angular_velocity =
+        q16_to_float((tick_rate * angular_velocity_scale_) >> 8);
+    motor_data_.rpm = q16_to_float((tick_rate * rpm_scale_) >> 4);
+
+    // Accumulate the distance exactly, carrying the sub-Q16 remainder over.
+    distance_residual_ += dt_ticks * distance_scale_;
+    int32_t distance_step = distance_residual_ >> 12;
+    distance_residual_ -= distance_step * 4096;  // Negative backwards, not shifted
+    distance_q16_ += distance_step;
+    motor_data_.distance = q16_to_float(distance_q16_);
+}
+
+#else
+
+void MotorDriver::compute_motor_data_(const EncoderSample &sample, unsigned long time) {
+    update_tick_rate_(sample, time);
     motor_data_.rpm = compute_rpm_();
     motor_data_.angular_velocity = compute_angular_velocity_(motor_data_.rpm);
     motor_data_.velocity = compute_velocity_(motor_data_.angular_velocity);
     motor_data_.distance = compute_distance_();
 }
+
+#endif
@@ -0,0 +1,81 @@
+#include "parameter_store.hpp"
+
+#include <EEPROM.h>
+
+#include "binary_protocol.hpp"
+
+#define PARAMETER_STORE_MAGIC 0x4D43  // "MC"
+
+/**
+ * @struct StoreHeader
+ * @brief Header stored before the parameters.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t magic;   ///< PARAMETER_STORE_MAGIC.
+    uint8_t version;  ///< PARAMETER_STORE_VERSION.
+    uint16_t size;    ///< Size of the parameters (in bytes).
+} StoreHeader;
+
+static const uint16_t PARAMS_ADDRESS = PARAMETER_STORE_ADDRESS + sizeof(StoreHeader);
+static const uint16_t CRC_ADDRESS = PARAMS_ADDRESS + sizeof(Parameters);
+
+bool ParameterStore::load(Parameters &params) {
+    StoreHeader header;
+    read_(PARAMETER_STORE_ADDRESS, &header, sizeof(header));
+    if (header.magic != PARAMETER_STORE_MAGIC ||
+        header.version != PARAMETER_STORE_VERSION ||
+        header.size != sizeof(Parameters)) {
+        return false;
+    }
+
+    uint16_t crc;
+    read_(CRC_ADDRESS, &crc, sizeof(crc));
+    if (crc != crc_(PARAMETER_STORE_ADDRESS, CRC_ADDRESS - PARAMETER_STORE_ADDRESS)) {
+        return false;
+    }
+    read_(PARAMS_ADDRESS, &params, sizeof(params));
+    return true;
+}
+
+uint16_t ParameterStore::save(const Parameters &params) {
+    StoreHeader header;
+    header.magic = PARAMETER_STORE_MAGIC;
+    header.version = PARAMETER_STORE_VERSION;
+    header.size = sizeof(Parameters);
+
+    uint16_t crc = crc16(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+    crc = crc16(reinterpret_cast<const uint8_t *>(&params), sizeof(params), crc);
+
+    uint16_t written = write_(PARAMETER_STORE_ADDRESS, &header, sizeof(header));
+    written += write_(PARAMS_ADDRESS, &params, sizeof(params));
+    written += write_(CRC_ADDRESS, &crc, sizeof(crc));
+    return written;
+}
+
+void ParameterStore::read_(uint16_t address, void *data, size_t len) {
+    uint8_t *bytes = static_cast<uint8_t *>(data);
+    for (size_t i = 0; i < len; i++) {
+        bytes[i] = EEPROM.read(address + i);
+    }
+}
+
+uint16_t ParameterStore::write_(uint16_t address, const void *data, size_t len) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    uint16_t written = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (EEPROM.read(address + i) != bytes[i]) {
+            EEPROM.write(address + i, bytes[i]);
+            written++;
+        }
+    }
+    return written;
+}
+
+uint16_t ParameterStore::crc_(uint16_t address, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t byte = EEPROM.read(address + i);
+        crc = crc16(&byte, 1, crc);
+    }
+    return crc;
+}
@@ -0,0 +1,54 @@
+#include "position_profile.hpp"
+
+PositionProfile::PositionProfile(float max_velocity, float max_acceleration)
+    : max_velocity_(max_velocity), max_acceleration_(max_acceleration) {
+    start(0.0);
+}
+
+void PositionProfile::start(float distance) {
+    target_ = distance;
+    position_ = 0.0;
+    velocity_ = 0.0;
+    acceleration_ = 0.0;
+}
+
+void PositionProfile::update(float dt) {
+    float remaining = target_ - position_;
+    if (remaining == 0.0 && velocity_ == 0.0) {
+        acceleration_ = 0.0;
+        return;
+    }
+
+    // Largest speed v from which steps of v * dt, decelerating by a * dt, stop
+    // within the remaining distance: v * (v + a * dt) / (2 * a) <= remaining.
+    float speed = max_velocity_;
+    float a_dt = max_acceleration_ * dt;
+    if (max_acceleration_ > 0.0) {
+        float braking = -0.5 * a_dt + sqrt(0.25 * a_dt * a_dt +
+                                           2 * max_acceleration_ * fabs(remaining));
+        if (braking < speed) speed = braking;
+    }
+    float velocity = remaining > 0.0 ? speed : -speed;
+    if (max_acceleration_ > 0.0) {
+        if (velocity > velocity_ + a_dt) velocity = velocity_ + a_dt;
+        if (velocity < velocity_ - a_dt) velocity = velocity_ - a_dt;
+    }
+    acceleration_ = dt > 0.0 ? (velocity - velocity_) / dt : 0.0;
+    velocity_ = velocity;
+    position_ += velocity_ * dt;
+
+    // Snap to the target instead of overshooting it.
+    if ((remaining > 0.0 && position_ >= target_) ||
+        (remaining < 0.0 && position_ <= target_) || remaining == 0.0) {
+        position_ = target_;
+        velocity_ = 0.0;
+    }
+}
+
+bool PositionProfile::is_done(void) { return position_ == target_ && velocity_ == 0.0; }
+
+float PositionProfile::get_position(void) { return position_; }
+
+float PositionProfile::get_velocity(void) { return velocity_; }
+
+float PositionProfile::get_acceleration(void) { return acceleration_; }
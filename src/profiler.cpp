@@ -0,0 +1,75 @@
+#include "profiler.hpp"
+
+#if PROFILING
+
+#include <util/atomic.h>
+
+// Periods below 2^HISTOGRAM_SHIFT us fall in the first bin.
+static const uint8_t HISTOGRAM_SHIFT = 4;
+
+volatile Profiler::StageCounters Profiler::stages_[PROFILE_STAGE_COUNT] = {
+    {UINT16_MAX, 0, 0, 0},
+    {UINT16_MAX, 0, 0, 0},
+    {UINT16_MAX, 0, 0, 0},
+    {UINT16_MAX, 0, 0, 0},
+    {UINT16_MAX, 0, 0, 0},
+    {UINT16_MAX, 0, 0, 0}};
+uint16_t Profiler::loop_histogram_[PROFILER_HISTOGRAM_BINS];
+unsigned long Profiler::last_loop_pass_ = 0;
+
+static_assert(PROFILE_STAGE_COUNT == 6, "initialize the counters of every stage");
+
+void Profiler::record(ProfileStage stage, unsigned long duration) {
+    volatile StageCounters &counters = stages_[stage];
+    if (counters.count == UINT16_MAX) {
+        return;  // Full until read, the mean stays exact.
+    }
+    uint16_t d = duration > UINT16_MAX ? UINT16_MAX : duration;
+    if (d < counters.min_duration) counters.min_duration = d;
+    if (d > counters.max_duration) counters.max_duration = d;
+    counters.sum += d;
+    counters.count++;
+}
+
+void Profiler::record_loop_pass() {
+    unsigned long now = micros();
+    if (last_loop_pass_ != 0) {
+        unsigned long period = (now - last_loop_pass_) >> HISTOGRAM_SHIFT;
+        uint8_t bin = 0;
+        while (period != 0 && bin < PROFILER_HISTOGRAM_BINS - 1) {
+            period >>= 1;
+            bin++;
+        }
+        if (loop_histogram_[bin] < UINT16_MAX) {
+            loop_histogram_[bin]++;
+        }
+    }
+    last_loop_pass_ = now;
+}
+
+void Profiler::read(StageProfile *stages, uint16_t *loop_histogram) {
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        StageCounters counters;
+        // The control stages may be recorded from the timer interrupt.
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            counters.min_duration = stages_[i].min_duration;
+            counters.max_duration = stages_[i].max_duration;
+            counters.sum = stages_[i].sum;
+            counters.count = stages_[i].count;
+            stages_[i].min_duration = UINT16_MAX;
+            stages_[i].max_duration = 0;
+            stages_[i].sum = 0;
+            stages_[i].count = 0;
+        }
+        stages[i].min_duration = counters.count ? counters.min_duration : 0;
+        stages[i].max_duration = counters.max_duration;
+        stages[i].mean_duration = counters.count ? counters.sum / counters.count : 0;
+        stages[i].count = counters.count;
+    }
+    for (uint8_t i = 0; i < PROFILER_HISTOGRAM_BINS; i++) {
+        loop_histogram[i] = loop_histogram_[i];
+        loop_histogram_[i] = 0;
+    }
+}
+
+#endif
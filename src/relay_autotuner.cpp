@@ -0,0 +1,139 @@
+#include "relay_autotuner.hpp"
+
+#include "configuration.hpp"
+
+// Cycles discarded while the oscillation settles.
+#define AUTOTUNE_SETTLING_CYCLES 2
+
+RelayAutotuner::RelayAutotuner() {
+    state_ = AutotuneState::IDLE;
+    result_ = {0.0, 0.0};
+}
+
+void RelayAutotuner::start(float setpoint,
+                           uint8_t amplitude,
+                           float bias,
+                           unsigned long time) {
+    state_ = AutotuneState::RUNNING;
+    setpoint_ = setpoint;
+    amplitude_ = amplitude;
+    bias_ = bias;
+    output_high_ = true;
+    start_time_ = time;
+    cycle_start_ = time;
+    switch_time_ = time;
+    cycle_max_ = -1e9;
+    cycle_min_ = 1e9;
+    cycles_ = 0;
+    amplitude_sum_ = 0.0;
+    period_sum_ = 0.0;
+}
+
+void RelayAutotuner::cancel(void) { state_ = AutotuneState::IDLE; }
+
+int RelayAutotuner::update(float velocity, unsigned long time) {
+    if (state_ == AutotuneState::IDLE || state_ == AutotuneState::FAILED) {
+        return 0;
+    }
+    // Once DONE, the relay keeps running without measuring until cancelled.
+    bool measuring = state_ == AutotuneState::RUNNING;
+    if (measuring && time - start_time_ > AUTOTUNE_TIMEOUT_MS * 1000UL) {
+        state_ = AutotuneState::FAILED;
+        return 0;
+    }
+
+    if (velocity > cycle_max_) cycle_max_ = velocity;
+    if (velocity < cycle_min_) cycle_min_ = velocity;
+
+    if (output_high_ && velocity > setpoint_ + AUTOTUNE_NOISE_BAND) {
+        output_high_ = false;
+        switch_time_ = time;
+    } else if (!output_high_ && velocity < setpoint_ - AUTOTUNE_NOISE_BAND) {
+        output_high_ = true;
+        if (measuring) {
+            end_cycle_(time);
+            if (state_ == AutotuneState::FAILED) {
+                return 0;
+            }
+        }
+    }
+
+    float pwm = output_high_ ? bias_ + amplitude_ : bias_ - amplitude_;
+    if (pwm > 255) pwm = 255;
+    if (pwm < -255) pwm = -255;
+    return int(pwm);
+}
+
+void RelayAutotuner::end_cycle_(unsigned long time) {
+    float period = (time - cycle_start_) * 1e-6;
+    float high_time = (switch_time_ - cycle_start_) * 1e-6;
+    float amplitude = (cycle_max_ - cycle_min_) / 2;
+    cycle_start_ = time;
+    cycle_max_ = -1e9;
+    cycle_min_ = 1e9;
+
+    // Spending longer on the high output means the bias is too low.
+    if (period > 0.0) {
+        bias_ += amplitude_ * (2 * high_time - period) / period / 2;
+    }
+
+    cycles_++;
+    if (cycles_ <= AUTOTUNE_SETTLING_CYCLES) {
+        return;
+    }
+    amplitude_sum_ += amplitude;
+    period_sum_ += period;
+    if (cycles_ < AUTOTUNE_SETTLING_CYCLES + AUTOTUNE_CYCLES) {
+        return;
+    }
+
+    float a = amplitude_sum_ / AUTOTUNE_CYCLES;
+    float band = AUTOTUNE_NOISE_BAND;
+    if (a <= band) {
+        state_ = AutotuneState::FAILED;
+        return;
+    }
+    result_.ultimate_gain = 4 * amplitude_ / (PI * sqrt(a * a - band * band));
+    result_.ultimate_period = period_sum_ / AUTOTUNE_CYCLES;
+    state_ = AutotuneState::DONE;
+}
+
+AutotuneState RelayAutotuner::get_state(void) { return state_; }
+
+void RelayAutotuner::get_result(AutotuneResult &result) { result = result_; }
+
+pid_gains_t RelayAutotuner::compute_gains(float ultimate_gain,
+                                          float ultimate_period,
+                                          TuningRule rule) {
+    // Proportional gain, integral and derivative times as fractions of Ku and Pu.
+    float kp, ti, td;
+    switch (rule) {
+        case RULE_TYREUS_LUYBEN:
+            kp = ultimate_gain / 2.2;
+            ti = 2.2 * ultimate_period;
+            td = ultimate_period / 6.3;
+            break;
+        case RULE_SOME_OVERSHOOT:
+            kp = 0.33 * ultimate_gain;
+            ti = ultimate_period / 2;
+            td = ultimate_period / 3;
+            break;
+        case RULE_NO_OVERSHOOT:
+            kp = 0.2 * ultimate_gain;
+            ti = ultimate_period / 2;
+            td = ultimate_period / 3;
+            break;
+        case RULE_ZIEGLER_NICHOLS:
+        default:
+            kp = 0.6 * ultimate_gain;
+            ti = ultimate_period / 2;
+            td = ultimate_period / 8;
+            break;
+    }
+
+    pid_gains_t gains;
+    gains.kp = kp;
+    gains.ki = kp / ti;
+    gains.kd = kp * td;
+    return gains;
+}
@@ -0,0 +1,77 @@
+#include "sample_recorder.hpp"
+
+static_assert(RECORDER_SIZE <= 255, "record indexes are 8 bits");
+static_assert(RECORDER_PRETRIGGER < RECORDER_SIZE, "no room after the trigger");
+
+SampleRecorder::SampleRecorder()
+    : state_(RECORDER_IDLE),
+      head_(0),
+      count_(0),
+      remaining_(0),
+      trigger_index_(0),
+      divider_(1),
+      ticks_(0) {}
+
+void SampleRecorder::arm(RecorderTrigger trigger, uint8_t divider) {
+    head_ = 0;
+    count_ = 0;
+    trigger_index_ = 0;
+    divider_ = divider > 0 ? divider : 1;
+    // The first tick is recorded.
+    ticks_ = divider_ - 1;
+    if (trigger == TRIGGER_NOW) {
+        remaining_ = RECORDER_SIZE;
+        state_ = RECORDER_RECORDING;
+    } else {
+        remaining_ = 0;
+        state_ = RECORDER_ARMED;
+    }
+}
+
+void SampleRecorder::trigger() {
+    if (state_ != RECORDER_ARMED) {
+        return;
+    }
+    trigger_index_ = count_ < RECORDER_PRETRIGGER ? count_ : RECORDER_PRETRIGGER;
+    remaining_ = RECORDER_SIZE - trigger_index_;
+    state_ = RECORDER_RECORDING;
+}
+
+bool SampleRecorder::tick() {
+    if (state_ != RECORDER_ARMED && state_ != RECORDER_RECORDING) {
+        return false;
+    }
+    if (++ticks_ < divider_) {
+        return false;
+    }
+    ticks_ = 0;
+    return true;
+}
+
+void SampleRecorder::record(const WheelSample *wheels) {
+    memcpy(records_[head_], wheels, sizeof(records_[head_]));
+    head_ = head_ + 1 < RECORDER_SIZE ? head_ + 1 : 0;
+    if (count_ < RECORDER_SIZE) {
+        count_++;
+    }
+    if (state_ == RECORDER_RECORDING && --remaining_ == 0) {
+        state_ = RECORDER_DONE;
+    }
+}
+
+void SampleRecorder::get_status(RecorderStatus &status) {
+    status.state = state_;
+    status.count = count_;
+    status.trigger_index = trigger_index_;
+    status.divider = divider_;
+}
+
+bool SampleRecorder::get_record(uint8_t index, WheelSample *wheels) {
+    if (index >= count_) {
+        return false;
+    }
+    // The oldest record is count_ records behind the head.
+    uint16_t slot = uint16_t(head_) + RECORDER_SIZE - count_ + index;
+    memcpy(wheels, records_[slot % RECORDER_SIZE], sizeof(records_[0]));
+    return true;
+}
@@ -1,67 +1,119 @@
 #include "serial_protocol.hpp"
 
+/**
+ * @brief Copy motor data into its wire layout.
+ */
+static void to_msg(const MotorData& motor_data, MotorDataMsg& msg) {
+    msg.rpm = motor_data.rpm;
+    msg.velocity = motor_data.velocity;
+    msg.angular_velocity = motor_data.angular_velocity;
+    msg.distance = motor_data.distance;
+    msg.angle = motor_data.angle;
+}
+
+static void to_msg(const MotorData* motors, uint8_t count, MotorStatusMsg& msg) {
+    memset(&msg, 0, sizeof(msg));
+    for (uint8_t i = 0; i < count; i++) {
+        to_msg(motors[i], msg.wheels[i]);
+    }
+}
+
+/**
+ * @brief Copy a velocity command from its wire layout.
+ * @return False if a velocity is not finite.
+ */
+static bool from_msg(const CmdVelMsg& msg, CmdVel& cmd_vel) {
+    if (isnan(msg.x) || isinf(msg.x) || isnan(msg.w) || isinf(msg.w)) {
+        return false;
+    }
+    cmd_vel.x = msg.x;
+    cmd_vel.w = msg.w;
+    return true;
+}
+
+static_assert(sizeof(RecorderDataMsg::records[0][0]) == sizeof(WheelSample),
+              "records are copied in their wire layout");
+static_assert(SERIAL_MAX_REPLY_SIZE >=
+                  BINARY_FRAME_BUFFER_SIZE(BINARY_MAX_TX_PAYLOAD_SIZE) + 1,
+              "SERIAL_MAX_REPLY_SIZE too small for the binary frames");
+#if PROFILING
+static_assert(SERIAL_PROFILE_REPLY_SIZE >=
+                  24 * PROFILE_STAGE_COUNT + 6 * PROFILER_HISTOGRAM_BINS + 2,
+              "SERIAL_PROFILE_REPLY_SIZE too small for the profile");
+#endif
+
 SerialProtocol::SerialProtocol(MotorController* motorCtrl) {
     motorController_ = motorCtrl;
+    mode_ = ProtocolMode::TEXT;
+    rx_frame_len_ = 0;
+    rx_frame_overflow_ = false;
+    invalid_frames_ = 0;
+    telemetry_divider_ = 0;
+    telemetry_calls_ = 0;
+    telemetry_seq_ = 0;
+    dump_index_ = -1;
+    setpoint_pending_ = false;
+    superseded_setpoints_ = 0;
 }
 
-int SerialProtocol::parse_cmd_(const String& cmd) {
-    char flag = cmd.charAt(0);
+int SerialProtocol::parse_cmd_(const char* cmd) {
+    PROFILE_SCOPE(PROFILE_PARSE_CMD);
+    char flag = cmd[0];
+    const char* args = cmd + 1;
+
+    // The other commands see the effect of the setpoints received before them.
+    if (flag != FLAG_CLOSE && flag != FLAG_OPEN) {
+        apply_setpoint_();
+    }
 
     switch (flag) {
-        case FLAG_CLOSE:
-            int x, w;
-            if (sscanf(cmd.c_str(), "c %d %d", &x, &w) == 2) {
-                CmdVel cmd_vel;
-                cmd_vel.x = x / 1000.0;
-                cmd_vel.w = w / 1000.0;
-                motorController_->set_cmd_vel(cmd_vel);
-                return 0;  // Success
+        case FLAG_CLOSE: {
+            int32_t x, w;
+            if (parse_int(args, x) && parse_int(args, w)) {
+                Setpoint setpoint;
+                setpoint.open_loop = false;
+                setpoint.cmd_vel.x = x / 1000.0;
+                setpoint.cmd_vel.w = w / 1000.0;
+                return submit_setpoint_(setpoint);
             }
             break;
+        }
 
-        case FLAG_OPEN:
-            unsigned int left_pwm_val, right_pwm_val;
-            if (sscanf(cmd.c_str(), "o %u %u", &left_pwm_val, &right_pwm_val) == 2) {
-                if (left_pwm_val <= 255 && right_pwm_val <= 255) {
-                    motorController_->move_open_loop(left_pwm_val, right_pwm_val);
-                    return 0;  // Success
+        case FLAG_OPEN: {
+            int32_t left_pwm_val, right_pwm_val;
+            if (parse_int(args, left_pwm_val) && parse_int(args, right_pwm_val)) {
+                if (left_pwm_val >= 0 && left_pwm_val <= 255 && right_pwm_val >= 0 &&
+                    right_pwm_val <= 255) {
+                    Setpoint setpoint;
+                    setpoint.open_loop = true;
+                    setpoint.left_pwm = left_pwm_val;
+                    setpoint.right_pwm = right_pwm_val;
+                    return submit_setpoint_(setpoint);
                 } else {
                     return -2;  // Error: PWM values out of range
                 }
             }
             break;
+        }
 
         case FLAG_POSE:
             Pose pose;
             motorController_->get_pose(pose);
-            Serial.println(String(pose.x) + " " + String(pose.y) + " " +
-                           String(pose.theta));
+            tx_.print(pose.x);
+            tx_.print(" ");
+            tx_.print(pose.y);
+            tx_.print(" ");
+            tx_.println(pose.theta);
             return 1;  // Success and returned pose
             break;
 
         case FLAG_MOTOR_STATUS:
-            MotorData left_motor;
-            MotorData right_motor;
-            motorController_->get_motor_status(left_motor, right_motor);
-            Serial.print(left_motor.rpm);
-            Serial.print(" ");
-            Serial.print(left_motor.velocity);
-            Serial.print(" ");
-            Serial.print(left_motor.angular_velocity);
-            Serial.print(" ");
-            Serial.print(left_motor.distance);
-            Serial.print(" ");
-            Serial.print(left_motor.angle);
-            Serial.print(",");
-            Serial.print(right_motor.rpm);
-            Serial.print(" ");
-            Serial.print(right_motor.velocity);
-            Serial.print(" ");
-            Serial.print(right_motor.angular_velocity);
-            Serial.print(" ");
-            Serial.print(right_motor.distance);
-            Serial.print(" ");
-            Serial.print(right_motor.angle);
+            MotorData motors[MAX_WHEELS];
+            motorController_->get_motor_status(motors);
+            for (uint8_t i = 0; i < motorController_->get_wheel_count(); i++) {
+                if (i > 0) tx_.print(",");
+                print_motor_data_(motors[i]);
+            }
 
             return 1;  // Success and returned pose
             break;
@@ -71,14 +123,13 @@ int SerialProtocol::parse_cmd_(const String& cmd) {
             break;
 
         case FLAG_PID_GAINS: {
-            int kp = 0, ki = 0, kd = 0;
-            if (sscanf(cmd.c_str(), "p %d %d %d", &kp, &ki, &kd) == 3) {
+            int32_t kp = 0, ki = 0, kd = 0;
+            if (parse_int(args, kp) && parse_int(args, ki) && parse_int(args, kd)) {
                 pid_gains_t pid_gains;
                 pid_gains.kp = kp;
                 pid_gains.ki = ki;
                 pid_gains.kd = kd;
-                motorController_->update_motor_pids(pid_gains);
-                return 0;  // Success
+                return motorController_->update_motor_pids(pid_gains) ? 0 : -1;
             } else {
                 return -1;  // Error: Invalid command
             }
@@ -87,15 +138,284 @@ int SerialProtocol::parse_cmd_(const String& cmd) {
 
         case FLAG_PID_GET: {
             auto pid_gains = motorController_->get_motor_pids();
-            Serial.print(pid_gains.kp);
-            Serial.print(" ");
-            Serial.print(pid_gains.ki);
-            Serial.print(" ");
-            Serial.print(pid_gains.kd);
+            tx_.print(pid_gains.kp);
+            tx_.print(" ");
+            tx_.print(pid_gains.ki);
+            tx_.print(" ");
+            tx_.print(pid_gains.kd);
             return 1;  // Success and return pid gains
             break;
         }
 
+        case FLAG_FEEDFORWARD: {
+            int32_t ks = 0, kv = 0, ka = 0;
+            if (parse_int(args, ks) && parse_int(args, kv) && parse_int(args, ka)) {
+                FeedForwardGains gains;
+                gains.ks = ks;
+                gains.kv = kv;
+                gains.ka = ka;
+                return motorController_->update_feedforward_gains(gains) ? 0 : -1;
+            }
+            break;
+        }
+
+        case FLAG_FEEDFORWARD_GET: {
+            FeedForwardGains gains = motorController_->get_feedforward_gains();
+            tx_.print(gains.ks);
+            tx_.print(" ");
+            tx_.print(gains.kv);
+            tx_.print(" ");
+            tx_.println(gains.ka);
+            return 1;  // Success and return feed-forward gains
+            break;
+        }
+
+        case FLAG_AUTOTUNE: {
+            int32_t setpoint, amplitude, rule;
+            if (parse_int(args, setpoint) && parse_int(args, amplitude) &&
+                parse_int(args, rule)) {
+                if (amplitude < 0 || amplitude > 255 || rule < 0 ||
+                    rule > RULE_NO_OVERSHOOT) {
+                    return -1;  // Error: Invalid command
+                }
+                bool started = motorController_->start_autotune(
+                    setpoint / 1000.0, amplitude, rule);
+                return started ? 0 : -1;
+            }
+            break;
+        }
+
+        case FLAG_AUTOTUNE_GET: {
+            AutotuneResult results[MAX_WHEELS];
+            AutotuneState state = motorController_->get_autotune_state();
+            motorController_->get_autotune_result(results);
+            tx_.print(int(state));
+            for (uint8_t i = 0; i < motorController_->get_wheel_count(); i++) {
+                tx_.print(" ");
+                tx_.print(results[i].ultimate_gain);
+                tx_.print(" ");
+                tx_.print(results[i].ultimate_period, 3);
+            }
+            tx_.println();
+            return 1;  // Success and returned auto-tuner status
+            break;
+        }
+
+        case FLAG_GAIN_SCHEDULE: {
+            int32_t wheel, index, velocity, kp, ki, kd;
+            if (parse_int(args, wheel) && parse_int(args, index) &&
+                parse_int(args, velocity) && parse_int(args, kp) &&
+                parse_int(args, ki) && parse_int(args, kd)) {
+                if (wheel < 0 || wheel >= motorController_->get_wheel_count() ||
+                    index < 0 || index > 255) {
+                    return -1;  // Error: Invalid command
+                }
+                GainBreakpoint breakpoint;
+                breakpoint.velocity = velocity / 1000.0;
+                breakpoint.gains.kp = kp;
+                breakpoint.gains.ki = ki;
+                breakpoint.gains.kd = kd;
+                bool success =
+                    motorController_->set_gain_breakpoint(wheel, index, breakpoint);
+                return success ? 0 : -1;
+            }
+            break;
+        }
+
+        case FLAG_GAIN_SCHEDULE_GET: {
+            int32_t wheel;
+            if (!parse_int(args, wheel) || wheel < 0 ||
+                wheel >= motorController_->get_wheel_count()) {
+                break;
+            }
+            GainBreakpoint breakpoints[PID_GAIN_SCHEDULE_SIZE];
+            uint8_t count = motorController_->get_gain_schedule(wheel, breakpoints);
+            for (uint8_t i = 0; i < count; i++) {
+                if (i > 0) tx_.print(",");
+                tx_.print(long(breakpoints[i].velocity * 1000 + 0.5));
+                tx_.print(" ");
+                tx_.print(breakpoints[i].gains.kp);
+                tx_.print(" ");
+                tx_.print(breakpoints[i].gains.ki);
+                tx_.print(" ");
+                tx_.print(breakpoints[i].gains.kd);
+            }
+            tx_.println();
+            return 1;  // Success and returned gain schedule
+        }
+
+        case FLAG_GEOMETRY: {
+            int32_t wheel_radius, ticks_per_rev, dist_between_wheels;
+            if (parse_int(args, wheel_radius) && parse_int(args, ticks_per_rev) &&
+                parse_int(args, dist_between_wheels)) {
+                if (ticks_per_rev <= 0 || ticks_per_rev > UINT16_MAX) {
+                    return -1;  // Error: Invalid command
+                }
+                Geometry geometry;
+                geometry.wheel_radius = wheel_radius / 1000000.0;
+                geometry.ticks_per_rev = ticks_per_rev;
+                geometry.dist_between_wheels = dist_between_wheels / 1000.0;
+                return motorController_->set_geometry(geometry) ? 0 : -1;
+            }
+            break;
+        }
+
+        case FLAG_GEOMETRY_GET: {
+            Geometry geometry;
+            motorController_->get_geometry(geometry);
+            tx_.print(long(geometry.wheel_radius * 1000000 + 0.5));
+            tx_.print(" ");
+            tx_.print(geometry.ticks_per_rev);
+            tx_.print(" ");
+            tx_.println(long(geometry.dist_between_wheels * 1000 + 0.5));
+            return 1;  // Success and returned geometry
+        }
+
+        case FLAG_SAVE: {
+            Parameters params;
+            motorController_->get_parameters(params);
+            tx_.println(ParameterStore::save(params));
+            return 1;  // Success and returned the number of bytes written
+        }
+
+        case FLAG_BINARY:
+            // Acknowledged in text, everything after is binary frames.
+            mode_ = ProtocolMode::BINARY;
+            line_reader_.clear();
+            rx_frame_len_ = 0;
+            rx_frame_overflow_ = false;
+            return 0;  // Success
+            break;
+
+        case FLAG_TELEMETRY: {
+            int32_t rate;
+            if (parse_int(args, rate) && rate >= 0 && rate <= 255) {
+                set_telemetry_rate_(rate);
+                return 0;  // Success
+            }
+            break;
+        }
+
+        case FLAG_STATS:
+            tx_.print(line_reader_.get_overflow_count());
+            tx_.print(" ");
+            tx_.print(invalid_frames_);
+            tx_.print(" ");
+            tx_.print(motorController_->get_encoder_error_count());
+            tx_.print(" ");
+            tx_.println(superseded_setpoints_);
+            return 1;  // Success and returned counters
+            break;
+
+        case FLAG_LOOP_TIMING: {
+            LoopTiming timing;
+            motorController_->get_loop_timing(timing);
+            tx_.print(timing.min_period);
+            tx_.print(" ");
+            tx_.print(timing.max_period);
+            tx_.print(" ");
+            tx_.print(timing.mean_period);
+            tx_.print(" ");
+            tx_.println(timing.count);
+            return 1;  // Success and returned timing
+            break;
+        }
+
+        case FLAG_TASK_STATS:
+            for (uint8_t i = 0; i < TaskScheduler::get_task_count(); i++) {
+                TaskStats stats;
+                TaskScheduler::get_stats(i, stats);
+                if (i > 0) tx_.print(",");
+                tx_.print(stats.runs);
+                tx_.print(" ");
+                tx_.print(stats.overruns);
+                tx_.print(" ");
+                tx_.print(stats.deadline_misses);
+                tx_.print(" ");
+                tx_.print(stats.max_duration);
+            }
+            tx_.println();
+            return 1;  // Success and returned the task statistics
+            break;
+
+        case FLAG_RECORD: {
+            int32_t trigger, divider;
+            if (parse_int(args, trigger) && parse_int(args, divider) && trigger >= 0 &&
+                trigger <= TRIGGER_SETPOINT && divider > 0 && divider <= 255) {
+                motorController_->start_recording(trigger, divider);
+                return 0;  // Success
+            }
+            break;
+        }
+
+        case FLAG_RECORD_DUMP: {
+            RecorderStatus status;
+            motorController_->get_recorder_status(status);
+            tx_.print(status.state);
+            tx_.print(" ");
+            tx_.print(status.count);
+            tx_.print(" ");
+            tx_.print(status.trigger_index);
+            tx_.print(" ");
+            tx_.println(status.divider);
+            // The records follow, a line at a time, see dump_records_().
+            dump_index_ = 0;
+            return 1;  // Success and returned the records
+        }
+
+        case FLAG_CLOSE_REPORT: {
+            int32_t x, w;
+            if (parse_int(args, x) && parse_int(args, w)) {
+                CmdVel cmd_vel;
+                cmd_vel.x = x / 1000.0;
+                cmd_vel.w = w / 1000.0;
+                motorController_->set_cmd_vel(cmd_vel);
+
+                Pose pose;
+                MotorData motors[MAX_WHEELS];
+                motorController_->get_pose(pose);
+                motorController_->get_motor_status(motors);
+                print_state_(motorController_->get_tick_time(), pose, motors,
+                             motorController_->get_wheel_count());
+                return 1;  // Success and returned the state
+            }
+            break;
+        }
+
+        case FLAG_MOVE: {
+            int32_t distance, angle;
+            if (parse_int(args, distance) && parse_int(args, angle)) {
+                if (motorController_->start_move(distance / 1000.0, angle / 1000.0)) {
+                    return 0;  // Success
+                }
+            }
+            break;
+        }
+
+#if PROFILING
+        case FLAG_PROFILE: {
+            StageProfile stages[PROFILE_STAGE_COUNT];
+            uint16_t loop_histogram[PROFILER_HISTOGRAM_BINS];
+            Profiler::read(stages, loop_histogram);
+            for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+                tx_.print(stages[i].min_duration);
+                tx_.print(" ");
+                tx_.print(stages[i].max_duration);
+                tx_.print(" ");
+                tx_.print(stages[i].mean_duration);
+                tx_.print(" ");
+                tx_.print(stages[i].count);
+                tx_.print(",");
+            }
+            for (uint8_t i = 0; i < PROFILER_HISTOGRAM_BINS; i++) {
+                if (i > 0) tx_.print(" ");
+                tx_.print(loop_histogram[i]);
+            }
+            tx_.println();
+            return 1;  // Success and returned the profile
+        }
+#endif
+
         default:
             return -1;  // Error: Invalid command
             break;
@@ -104,35 +424,570 @@ int SerialProtocol::parse_cmd_(const String& cmd) {
 }
 
 void SerialProtocol::read_serial() {
-    while (Serial.available()) {
-        char c = Serial.read();
-        static String inputBuffer = "";
+    PROFILE_SCOPE(PROFILE_READ_SERIAL);
+    tx_.flush();
+    dump_records_();
+    report_move_();
 
-        if (c == '\n') {
-            int ret = parse_cmd_(inputBuffer);
-            send_ack(ret);
-            inputBuffer = "";
+    // A command is only processed once its reply is sure to fit, the next bytes
+    // wait in the receive buffer. Telemetry always leaves that much room.
+    while (tx_.get_free_space() >= SERIAL_MAX_REPLY_SIZE && dump_index_ < 0 &&
+           Serial.available()) {
+        char c = Serial.read();
+        if (mode_ == ProtocolMode::BINARY) {
+            read_binary_(c);
         } else {
-            inputBuffer += c;
+            read_text_(c);
         }
+        tx_.flush();
     }
+    apply_setpoint_();
+}
+
+int SerialProtocol::submit_setpoint_(const Setpoint& setpoint) {
+    if (setpoint_pending_) {
+        superseded_setpoints_++;
+    }
+    setpoint_ = setpoint;
+    setpoint_pending_ = true;
+    if (!SERIAL_COALESCE_SETPOINTS) {
+        apply_setpoint_();
+    }
+    // Fire and forget setpoints are not acknowledged, as if they returned data.
+    return SERIAL_ACK_SETPOINTS ? 0 : 1;
+}
+
+void SerialProtocol::apply_setpoint_() {
+    if (!setpoint_pending_) {
+        return;
+    }
+    setpoint_pending_ = false;
+    if (setpoint_.open_loop) {
+        motorController_->move_open_loop(setpoint_.left_pwm, setpoint_.right_pwm);
+    } else {
+        motorController_->set_cmd_vel(setpoint_.cmd_vel);
+    }
+}
+
+void SerialProtocol::read_text_(char c) {
+    int code;
+    switch (line_reader_.push(c)) {
+        case LineStatus::READY:
+            tx_.begin_reply();
+            code = parse_cmd_(line_reader_.get_line());
+            break;
+        case LineStatus::DROPPED:
+            tx_.begin_reply();
+            code = -4;  // Error: Command too long
+            break;
+        default:
+            return;
+    }
+    if (!tx_.end_reply()) {
+        tx_.begin_reply();
+        code = -5;  // Error: Reply too long
+    }
+    send_ack(code);
+    tx_.end_reply();
+}
+
+void SerialProtocol::report_move_() {
+    // Taken only when it fits, like the reply to a command.
+    MoveStatus status;
+    if (tx_.get_free_space() < SERIAL_MAX_REPLY_SIZE || dump_index_ >= 0 ||
+        !motorController_->get_move_event(status)) {
+        return;
+    }
+    tx_.begin_reply();
+    if (mode_ == ProtocolMode::BINARY) {
+        MoveDoneMsg msg = {uint8_t(status.state), status.distance, status.angle};
+        send_frame_(MSG_MOVE_DONE, &msg, sizeof(msg));
+    } else {
+        tx_.print("move ");
+        tx_.print(status.state);
+        tx_.print(" ");
+        tx_.print(status.distance, 3);
+        tx_.print(" ");
+        tx_.println(status.angle, 3);
+    }
+    tx_.end_reply();
+    tx_.flush();
+}
+
+void SerialProtocol::dump_records_() {
+    while (dump_index_ >= 0) {
+        WheelSample wheels[MAX_WHEELS];
+        if (!motorController_->get_record(dump_index_, wheels)) {
+            dump_index_ = -1;
+            return;
+        }
+        tx_.begin_reply();
+        for (uint8_t i = 0; i < motorController_->get_wheel_count(); i++) {
+            if (i > 0) tx_.print(",");
+            tx_.print(wheels[i].setpoint);
+            tx_.print(" ");
+            tx_.print(wheels[i].velocity);
+            tx_.print(" ");
+            tx_.print(wheels[i].pwm);
+            tx_.print(" ");
+            tx_.print(wheels[i].ticks);
+        }
+        tx_.println();
+        if (!tx_.end_reply()) {
+            return;  // Retried once the UART has taken more bytes.
+        }
+        dump_index_++;
+    }
+}
+
+void SerialProtocol::set_telemetry_rate_(uint8_t rate) {
+    if (rate == 0) {
+        telemetry_divider_ = 0;
+        return;
+    }
+    uint8_t divider = TELEMETRY_FREQUENCY / rate;
+    telemetry_divider_ = divider > 0 ? divider : 1;
+    telemetry_calls_ = 0;
+    telemetry_seq_ = 0;
+}
+
+void SerialProtocol::stream_telemetry() {
+    if (telemetry_divider_ == 0) {
+        return;
+    }
+    if (++telemetry_calls_ < telemetry_divider_) {
+        return;
+    }
+    if (dump_index_ >= 0) {
+        telemetry_calls_--;  // Deferred to the next run.
+        return;
+    }
+
+    Pose pose;
+    MotorData motors[MAX_WHEELS];
+    motorController_->get_pose(pose);
+    motorController_->get_motor_status(motors);
+    uint8_t wheel_count = motorController_->get_wheel_count();
+    unsigned long timestamp = motorController_->get_tick_time();
+
+    tx_.begin_reply();
+    if (mode_ == ProtocolMode::BINARY) {
+        TelemetryMsg msg;
+        msg.seq = telemetry_seq_;
+        msg.timestamp = timestamp;
+        msg.pose.x = pose.x;
+        msg.pose.y = pose.y;
+        msg.pose.theta = pose.theta;
+        to_msg(motors, wheel_count, msg.motors);
+        send_frame_(MSG_TELEMETRY, &msg, sizeof(msg));
+    } else {
+        tx_.print("t ");
+        tx_.print(telemetry_seq_);
+        tx_.print(" ");
+        print_state_(timestamp, pose, motors, wheel_count);
+    }
+    if (!tx_.end_reply(SERIAL_MAX_REPLY_SIZE)) {
+        telemetry_calls_--;  // Deferred to the next run.
+        return;
+    }
+    telemetry_calls_ = 0;
+    telemetry_seq_++;
+}
+
+void SerialProtocol::print_state_(unsigned long timestamp,
+                                  const Pose& pose,
+                                  const MotorData* motors,
+                                  uint8_t wheel_count) {
+    tx_.print(timestamp);
+    tx_.print(" ");
+    tx_.print(pose.x);
+    tx_.print(" ");
+    tx_.print(pose.y);
+    tx_.print(" ");
+    tx_.print(pose.theta);
+    for (uint8_t i = 0; i < wheel_count; i++) {
+        tx_.print(",");
+        print_motor_data_(motors[i]);
+    }
+    tx_.println();
+}
+
+void SerialProtocol::print_motor_data_(const MotorData& motor_data) {
+    tx_.print(motor_data.rpm);
+    tx_.print(" ");
+    tx_.print(motor_data.velocity);
+    tx_.print(" ");
+    tx_.print(motor_data.angular_velocity);
+    tx_.print(" ");
+    tx_.print(motor_data.distance);
+    tx_.print(" ");
+    tx_.print(motor_data.angle);
 }
 
 void SerialProtocol::send_ack(int code) {
     switch (code) {
         case 0:
-            Serial.println("OK");
+            tx_.println("OK");
             break;
         case 1:
             break;
         case -1:
-            Serial.println("ERR: Invalid command");
+            tx_.println("ERR: Invalid command");
             break;
         case -2:
-            Serial.println("ERR: PWM values out of range");
+            tx_.println("ERR: PWM values out of range");
+            break;
+        case -4:
+            tx_.println("ERR: Command too long");
+            break;
+        case -5:
+            tx_.println("ERR: Reply too long");
             break;
         default:
-            Serial.println("ERR: Unknown error");
+            tx_.println("ERR: Unknown error");
             break;
     }
 }
+
+void SerialProtocol::read_binary_(uint8_t byte) {
+    if (byte != 0) {
+        if (rx_frame_len_ >= sizeof(rx_frame_)) {
+            rx_frame_overflow_ = true;
+        } else if (!rx_frame_overflow_) {
+            rx_frame_[rx_frame_len_++] = byte;
+        }
+        return;
+    }
+
+    // Frame delimiter
+    size_t len = 0;
+    if (!rx_frame_overflow_) {
+        len = cobs_decode_in_place(rx_frame_, rx_frame_len_);
+    }
+    rx_frame_len_ = 0;
+    rx_frame_overflow_ = false;
+
+    tx_.begin_reply();
+    AckMsg ack = {0, -3};  // Error: Invalid frame
+    if (len > 2) {
+        len -= 2;
+        uint16_t crc = rx_frame_[len] | (uint16_t(rx_frame_[len + 1]) << 8);
+        if (crc == crc16(rx_frame_, len)) {
+            ack.id = rx_frame_[0];
+            ack.code = parse_frame_(rx_frame_, len);
+        }
+    }
+    if (ack.code == -3) {
+        invalid_frames_++;
+    }
+    if (!tx_.end_reply()) {
+        tx_.begin_reply();
+        ack.code = -5;  // Error: Reply too long
+    }
+    if (ack.code != 1) {
+        send_frame_(MSG_ACK, &ack, sizeof(ack));
+    }
+    tx_.end_reply();
+}
+
+int SerialProtocol::parse_frame_(const uint8_t* frame, size_t len) {
+    PROFILE_SCOPE(PROFILE_PARSE_CMD);
+    const uint8_t* payload = frame + 1;
+    size_t payload_len = len - 1;
+
+    if (frame[0] != MSG_CMD_VEL && frame[0] != MSG_OPEN_LOOP) {
+        apply_setpoint_();
+    }
+
+    switch (frame[0]) {
+        case MSG_CMD_VEL: {
+            if (payload_len != sizeof(CmdVelMsg)) return -1;
+            const CmdVelMsg* msg = reinterpret_cast<const CmdVelMsg*>(payload);
+            Setpoint setpoint;
+            setpoint.open_loop = false;
+            if (!from_msg(*msg, setpoint.cmd_vel)) return -1;
+            return submit_setpoint_(setpoint);
+        }
+
+        case MSG_OPEN_LOOP: {
+            if (payload_len != sizeof(OpenLoopMsg)) return -1;
+            const OpenLoopMsg* msg = reinterpret_cast<const OpenLoopMsg*>(payload);
+            Setpoint setpoint;
+            setpoint.open_loop = true;
+            setpoint.left_pwm = msg->left_pwm;
+            setpoint.right_pwm = msg->right_pwm;
+            return submit_setpoint_(setpoint);
+        }
+
+        case MSG_POSE_GET: {
+            Pose pose;
+            motorController_->get_pose(pose);
+            PoseMsg msg = {pose.x, pose.y, pose.theta};
+            send_frame_(MSG_POSE, &msg, sizeof(msg));
+            return 1;  // Success and returned pose
+        }
+
+        case MSG_MOTOR_STATUS_GET: {
+            MotorData motors[MAX_WHEELS];
+            motorController_->get_motor_status(motors);
+            MotorStatusMsg msg;
+            to_msg(motors, motorController_->get_wheel_count(), msg);
+            send_frame_(MSG_MOTOR_STATUS, &msg, sizeof(msg));
+            return 1;  // Success and returned motor status
+        }
+
+        case MSG_RESET_POSE:
+            motorController_->reset_pose();
+            return 0;  // Success
+
+        case MSG_PID_SET: {
+            if (payload_len != sizeof(PidGainsMsg)) return -1;
+            const PidGainsMsg* msg = reinterpret_cast<const PidGainsMsg*>(payload);
+            pid_gains_t pid_gains;
+            pid_gains.kp = msg->kp;
+            pid_gains.ki = msg->ki;
+            pid_gains.kd = msg->kd;
+            return motorController_->update_motor_pids(pid_gains) ? 0 : -1;
+        }
+
+        case MSG_PID_GET: {
+            auto pid_gains = motorController_->get_motor_pids();
+            PidGainsMsg msg = {pid_gains.kp, pid_gains.ki, pid_gains.kd};
+            send_frame_(MSG_PID_GAINS, &msg, sizeof(msg));
+            return 1;  // Success and returned pid gains
+        }
+
+        case MSG_FEEDFORWARD_SET: {
+            if (payload_len != sizeof(FeedForwardMsg)) return -1;
+            const FeedForwardMsg* msg = reinterpret_cast<const FeedForwardMsg*>(payload);
+            FeedForwardGains gains;
+            gains.ks = msg->ks;
+            gains.kv = msg->kv;
+            gains.ka = msg->ka;
+            return motorController_->update_feedforward_gains(gains) ? 0 : -1;
+        }
+
+        case MSG_FEEDFORWARD_GET: {
+            FeedForwardGains gains = motorController_->get_feedforward_gains();
+            FeedForwardMsg msg = {gains.ks, gains.kv, gains.ka};
+            send_frame_(MSG_FEEDFORWARD_GAINS, &msg, sizeof(msg));
+            return 1;  // Success and returned feed-forward gains
+        }
+
+        case MSG_AUTOTUNE_START: {
+            if (payload_len != sizeof(AutotuneStartMsg)) return -1;
+            const AutotuneStartMsg* msg =
+                reinterpret_cast<const AutotuneStartMsg*>(payload);
+            bool started = motorController_->start_autotune(
+                msg->setpoint, msg->amplitude, msg->rule);
+            return started ? 0 : -1;
+        }
+
+        case MSG_AUTOTUNE_GET: {
+            AutotuneResult results[MAX_WHEELS];
+            AutotuneStatusMsg msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.state = uint8_t(motorController_->get_autotune_state());
+            motorController_->get_autotune_result(results);
+            for (uint8_t i = 0; i < motorController_->get_wheel_count(); i++) {
+                msg.wheels[i].ku = results[i].ultimate_gain;
+                msg.wheels[i].pu = results[i].ultimate_period;
+            }
+            send_frame_(MSG_AUTOTUNE_STATUS, &msg, sizeof(msg));
+            return 1;  // Success and returned auto-tuner status
+        }
+
+        case MSG_GAIN_BREAKPOINT_SET: {
+            if (payload_len != sizeof(GainBreakpointMsg)) return -1;
+            const GainBreakpointMsg* msg =
+                reinterpret_cast<const GainBreakpointMsg*>(payload);
+            if (msg->wheel >= motorController_->get_wheel_count()) return -1;
+            GainBreakpoint breakpoint;
+            breakpoint.velocity = msg->velocity;
+            breakpoint.gains.kp = msg->gains.kp;
+            breakpoint.gains.ki = msg->gains.ki;
+            breakpoint.gains.kd = msg->gains.kd;
+            bool success = motorController_->set_gain_breakpoint(
+                msg->wheel, msg->index, breakpoint);
+            return success ? 0 : -1;
+        }
+
+        case MSG_GAIN_SCHEDULE_GET: {
+            if (payload_len != sizeof(WheelMsg)) return -1;
+            const WheelMsg* request = reinterpret_cast<const WheelMsg*>(payload);
+            if (request->wheel >= motorController_->get_wheel_count()) return -1;
+            GainBreakpoint breakpoints[PID_GAIN_SCHEDULE_SIZE];
+            GainScheduleMsg msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.wheel = request->wheel;
+            msg.count =
+                motorController_->get_gain_schedule(request->wheel, breakpoints);
+            for (uint8_t i = 0; i < msg.count; i++) {
+                msg.breakpoints[i].velocity = breakpoints[i].velocity;
+                msg.breakpoints[i].gains.kp = breakpoints[i].gains.kp;
+                msg.breakpoints[i].gains.ki = breakpoints[i].gains.ki;
+                msg.breakpoints[i].gains.kd = breakpoints[i].gains.kd;
+            }
+            send_frame_(MSG_GAIN_SCHEDULE, &msg, sizeof(msg));
+            return 1;  // Success and returned gain schedule
+        }
+
+        case MSG_GEOMETRY_SET: {
+            if (payload_len != sizeof(GeometryMsg)) return -1;
+            const GeometryMsg* msg = reinterpret_cast<const GeometryMsg*>(payload);
+            Geometry geometry;
+            geometry.wheel_radius = msg->wheel_radius;
+            geometry.dist_between_wheels = msg->dist_between_wheels;
+            geometry.ticks_per_rev = msg->ticks_per_rev;
+            return motorController_->set_geometry(geometry) ? 0 : -1;
+        }
+
+        case MSG_GEOMETRY_GET: {
+            Geometry geometry;
+            motorController_->get_geometry(geometry);
+            GeometryMsg msg = {geometry.wheel_radius,
+                               geometry.dist_between_wheels,
+                               geometry.ticks_per_rev};
+            send_frame_(MSG_GEOMETRY, &msg, sizeof(msg));
+            return 1;  // Success and returned geometry
+        }
+
+        case MSG_PARAMS_SAVE: {
+            Parameters params;
+            motorController_->get_parameters(params);
+            ParamsSavedMsg msg = {ParameterStore::save(params)};
+            send_frame_(MSG_PARAMS_SAVED, &msg, sizeof(msg));
+            return 1;  // Success and returned the number of bytes written
+        }
+
+        case MSG_TASK_STATS_GET: {
+            TaskStatsMsg msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.count = TaskScheduler::get_task_count();
+            for (uint8_t i = 0; i < msg.count; i++) {
+                TaskStats stats;
+                TaskScheduler::get_stats(i, stats);
+                msg.tasks[i].runs = stats.runs;
+                msg.tasks[i].overruns = stats.overruns;
+                msg.tasks[i].deadline_misses = stats.deadline_misses;
+                msg.tasks[i].max_duration = stats.max_duration;
+            }
+            send_frame_(MSG_TASK_STATS, &msg, sizeof(msg));
+            return 1;  // Success and returned the task statistics
+        }
+
+        case MSG_RECORDER_START: {
+            if (payload_len != sizeof(RecorderStartMsg)) return -1;
+            const RecorderStartMsg* msg =
+                reinterpret_cast<const RecorderStartMsg*>(payload);
+            if (msg->trigger > TRIGGER_SETPOINT) return -1;
+            bool started =
+                motorController_->start_recording(msg->trigger, msg->divider);
+            return started ? 0 : -1;
+        }
+
+        case MSG_RECORDER_GET: {
+            if (payload_len != sizeof(RecorderGetMsg)) return -1;
+            uint8_t index = reinterpret_cast<const RecorderGetMsg*>(payload)->index;
+            RecorderStatus status;
+            motorController_->get_recorder_status(status);
+            RecorderDataMsg msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.state = status.state;
+            msg.count = status.count;
+            msg.trigger_index = status.trigger_index;
+            msg.divider = status.divider;
+            msg.index = index;
+            WheelSample wheels[MAX_WHEELS];
+            for (uint8_t i = 0; i < BINARY_RECORDER_CHUNK_SIZE; i++) {
+                if (index + i > UINT8_MAX ||
+                    !motorController_->get_record(index + i, wheels)) {
+                    break;
+                }
+                memcpy(msg.records[i], wheels, sizeof(msg.records[i]));
+            }
+            send_frame_(MSG_RECORDER_DATA, &msg, sizeof(msg));
+            return 1;  // Success and returned the records
+        }
+
+        case MSG_MOVE: {
+            if (payload_len != sizeof(MoveMsg)) return -1;
+            const MoveMsg* msg = reinterpret_cast<const MoveMsg*>(payload);
+            if (!motorController_->start_move(msg->distance, msg->angle)) return -1;
+            return 0;  // Success
+        }
+
+        case MSG_CMD_VEL_REPORT: {
+            if (payload_len != sizeof(CmdVelMsg)) return -1;
+            const CmdVelMsg* cmd = reinterpret_cast<const CmdVelMsg*>(payload);
+            CmdVel cmd_vel;
+            if (!from_msg(*cmd, cmd_vel)) return -1;
+            motorController_->set_cmd_vel(cmd_vel);
+
+            Pose pose;
+            MotorData motors[MAX_WHEELS];
+            motorController_->get_pose(pose);
+            motorController_->get_motor_status(motors);
+            StateMsg msg;
+            msg.timestamp = motorController_->get_tick_time();
+            msg.pose.x = pose.x;
+            msg.pose.y = pose.y;
+            msg.pose.theta = pose.theta;
+            to_msg(motors, motorController_->get_wheel_count(), msg.motors);
+            send_frame_(MSG_STATE, &msg, sizeof(msg));
+            return 1;  // Success and returned the state
+        }
+
+#if PROFILING
+        case MSG_PROFILE_GET: {
+            ProfileMsg msg;
+            StageProfile stages[PROFILE_STAGE_COUNT];
+            uint16_t loop_histogram[PROFILER_HISTOGRAM_BINS];
+            Profiler::read(stages, loop_histogram);
+            memcpy(msg.loop_histogram, loop_histogram, sizeof(loop_histogram));
+            for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+                msg.stages[i].min_duration = stages[i].min_duration;
+                msg.stages[i].max_duration = stages[i].max_duration;
+                msg.stages[i].mean_duration = stages[i].mean_duration;
+                msg.stages[i].count = stages[i].count;
+            }
+            send_frame_(MSG_PROFILE, &msg, sizeof(msg));
+            return 1;  // Success and returned the profile
+        }
+#endif
+
+        case MSG_TELEMETRY_SET: {
+            if (payload_len != sizeof(TelemetryRateMsg)) return -1;
+            const TelemetryRateMsg* msg =
+                reinterpret_cast<const TelemetryRateMsg*>(payload);
+            set_telemetry_rate_(msg->rate);
+            return 0;  // Success
+        }
+
+        case MSG_TEXT_MODE:
+            // Acknowledged in binary, everything after is text commands.
+            mode_ = ProtocolMode::TEXT;
+            return 0;  // Success
+
+        default:
+            return -1;  // Error: Invalid command
+    }
+}
+
+void SerialProtocol::send_frame_(uint8_t id, const void* payload, size_t len) {
+    // The raw frame starts at index 1 so that it can be COBS encoded in place, and
+    // is followed by its delimiter.
+    uint8_t* frame = tx_.reserve(BINARY_FRAME_BUFFER_SIZE(len) + 1);
+    if (frame == nullptr) {
+        return;  // The reply overflows, see TxBuffer::end_reply().
+    }
+    frame[1] = id;
+    memcpy(&frame[2], payload, len);
+    uint16_t crc = crc16(&frame[1], len + 1);
+    frame[len + 2] = crc & 0xFF;
+    frame[len + 3] = crc >> 8;
+
+    size_t encoded_len = cobs_encode_in_place(frame, len + BINARY_FRAME_OVERHEAD);
+    frame[encoded_len] = 0;
+    tx_.commit(encoded_len + 1);
+}
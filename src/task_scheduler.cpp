@@ -0,0 +1,65 @@
+#include "task_scheduler.hpp"
+
+TaskScheduler::Task TaskScheduler::tasks_[SCHEDULER_MAX_TASKS];
+uint8_t TaskScheduler::task_count_ = 0;
+
+/**
+ * @brief Add to a counter, saturating instead of wrapping around.
+ */
+static void saturating_add(uint16_t &counter, uint32_t value) {
+    uint32_t sum = uint32_t(counter) + value;
+    counter = sum > UINT16_MAX ? UINT16_MAX : sum;
+}
+
+int8_t TaskScheduler::add_task(TaskFunction function,
+                               uint32_t period_us,
+                               uint32_t offset_us) {
+    if (task_count_ >= SCHEDULER_MAX_TASKS || period_us == 0) {
+        return -1;
+    }
+    Task &task = tasks_[task_count_];
+    task.function = function;
+    task.period = period_us;
+    task.next_release = micros() + offset_us;
+    task.stats = {0, 0, 0, 0};
+    return task_count_++;
+}
+
+void TaskScheduler::run() {
+    for (uint8_t i = 0; i < task_count_; i++) {
+        Task &task = tasks_[i];
+        unsigned long start = micros();
+        int32_t lateness = int32_t(start - task.next_release);
+        if (lateness < 0) {
+            continue;
+        }
+        if (uint32_t(lateness) >= task.period) {
+            uint32_t skipped = uint32_t(lateness) / task.period;
+            saturating_add(task.stats.overruns, skipped);
+            task.next_release += skipped * task.period;
+        }
+
+        task.function();
+
+        unsigned long end = micros();
+        task.next_release += task.period;
+        if (int32_t(end - task.next_release) > 0) {
+            saturating_add(task.stats.deadline_misses, 1);
+        }
+        uint32_t duration = end - start;
+        if (duration > task.stats.max_duration) {
+            task.stats.max_duration = duration > UINT16_MAX ? UINT16_MAX : duration;
+        }
+        task.stats.runs++;
+    }
+}
+
+uint8_t TaskScheduler::get_task_count() { return task_count_; }
+
+bool TaskScheduler::get_stats(uint8_t task, TaskStats &stats) {
+    if (task >= task_count_) {
+        return false;
+    }
+    stats = tasks_[task].stats;
+    return true;
+}
@@ -0,0 +1,144 @@
+#include "tx_buffer.hpp"
+
+TxBuffer::TxBuffer() : len_(0), sent_(0), reply_start_(0), overflow_(false) {}
+
+void TxBuffer::begin_reply() {
+    // Move the bytes not sent yet to the front, to make room at the end.
+    if (sent_ > 0) {
+        memmove(buffer_, buffer_ + sent_, len_ - sent_);
+        len_ -= sent_;
+        sent_ = 0;
+    }
+    reply_start_ = len_;
+    overflow_ = false;
+}
+
+bool TxBuffer::end_reply(uint16_t headroom) {
+    if (overflow_ || get_free_space() < headroom) {
+        len_ = reply_start_;
+        overflow_ = false;
+        return false;
+    }
+    return true;
+}
+
+void TxBuffer::append_(const char *data, size_t len) {
+    if (overflow_ || len > size_t(SERIAL_REPLY_BUFFER_SIZE - len_)) {
+        overflow_ = true;
+        return;
+    }
+    memcpy(buffer_ + len_, data, len);
+    len_ += len;
+}
+
+void TxBuffer::print(const char *str) { append_(str, strlen(str)); }
+
+void TxBuffer::print(char c) { append_(&c, 1); }
+
+void TxBuffer::print(int value) { print(long(value)); }
+
+void TxBuffer::print(unsigned int value) { print_unsigned_(value); }
+
+void TxBuffer::print(long value) {
+    if (value < 0) {
+        print('-');
+        print_unsigned_(0UL - (unsigned long)value);
+    } else {
+        print_unsigned_(value);
+    }
+}
+
+void TxBuffer::print(unsigned long value) { print_unsigned_(value); }
+
+void TxBuffer::print_unsigned_(unsigned long value, uint8_t min_digits) {
+    // Digits from the last, divided in 16 bits as soon as possible (much faster
+    // on 8-bit MCUs).
+    char digits[10];
+    uint8_t start = sizeof(digits);
+    while (value > UINT16_MAX) {
+        digits[--start] = '0' + value % 10;
+        value /= 10;
+    }
+    uint16_t rest = value;
+    do {
+        digits[--start] = '0' + rest % 10;
+        rest /= 10;
+    } while (rest != 0);
+    while (sizeof(digits) - start < min_digits) {
+        digits[--start] = '0';
+    }
+    append_(digits + start, sizeof(digits) - start);
+}
+
+void TxBuffer::print(double value, uint8_t decimals) {
+    float number = value;
+    if (isnan(number)) {
+        print("nan");
+        return;
+    }
+    if (isinf(number)) {
+        print("inf");
+        return;
+    }
+    if (decimals > 9) {
+        decimals = 9;
+    }
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+
+    // One multiplication and conversion, then integer digits.
+    float scaled = (number < 0 ? -number : number) * scale + 0.5f;
+    if (scaled >= 4294967040.0f) {
+        print("ovf");
+        return;
+    }
+    uint32_t fixed = scaled;
+    if (number < 0) {
+        print('-');
+    }
+    print_unsigned_(fixed / scale);
+    if (decimals > 0) {
+        print('.');
+        print_unsigned_(fixed % scale, decimals);
+    }
+}
+
+void TxBuffer::println() { print("\r\n"); }
+
+uint8_t *TxBuffer::reserve(size_t len) {
+    if (overflow_ || len > size_t(SERIAL_REPLY_BUFFER_SIZE - len_)) {
+        overflow_ = true;
+        return nullptr;
+    }
+    return buffer_ + len_;
+}
+
+void TxBuffer::commit(size_t len) { len_ += len; }
+
+bool TxBuffer::is_empty() { return len_ == 0; }
+
+uint16_t TxBuffer::get_free_space() {
+    return SERIAL_REPLY_BUFFER_SIZE - (len_ - sent_);
+}
+
+void TxBuffer::flush() {
+    if (sent_ == len_) {
+        return;
+    }
+    int room = Serial.availableForWrite();
+    if (room <= 0) {
+        return;
+    }
+    uint16_t count = len_ - sent_;
+    if (count > unsigned(room)) {
+        count = room;
+    }
+    Serial.write(buffer_ + sent_, count);
+    sent_ += count;
+    if (sent_ == len_) {
+        len_ = 0;
+        sent_ = 0;
+    }
+}
@@ -0,0 +1,75 @@
+#include "velocity_profile.hpp"
+
+VelocityProfile::VelocityProfile(float max_acceleration, float max_jerk) {
+    set_limits(max_acceleration, max_jerk);
+    reset();
+}
+
+void VelocityProfile::set_limits(float max_acceleration, float max_jerk) {
+    max_acceleration_ = max_acceleration;
+    max_jerk_ = max_jerk;
+}
+
+void VelocityProfile::set_target(float target) {
+    if (isnan(target) || isinf(target)) {
+        return;
+    }
+    target_ = target;
+}
+
+void VelocityProfile::reset(float velocity) {
+    target_ = velocity;
+    velocity_ = velocity;
+    acceleration_ = 0.0;
+}
+
+float VelocityProfile::update(float dt) {
+    float error = target_ - velocity_;
+    if (max_acceleration_ <= 0.0 || dt <= 0.0) {
+        velocity_ = target_;
+        acceleration_ = 0.0;
+        return velocity_;
+    }
+
+    // Close enough to stop within one jerk-limited step.
+    float j_dt = max_jerk_ * dt;
+    if (max_jerk_ > 0.0 && fabs(error) <= j_dt * dt && fabs(acceleration_) <= j_dt) {
+        velocity_ = target_;
+        acceleration_ = 0.0;
+        return velocity_;
+    }
+
+    // Acceleration that would close the remaining error in this step.
+    float desired = error / dt;
+    if (max_jerk_ > 0.0) {
+        // Largest acceleration from which the ramp back to 0 at max jerk, about
+        // a * 1.5 * dt + a^2 / (2 * jerk), still ends on the target.
+        float reachable =
+            -1.5 * j_dt + sqrt(2.25 * j_dt * j_dt + 2 * max_jerk_ * fabs(error));
+        if (fabs(desired) > reachable) desired = error > 0.0 ? reachable : -reachable;
+        if (desired > acceleration_ + j_dt) desired = acceleration_ + j_dt;
+        if (desired < acceleration_ - j_dt) desired = acceleration_ - j_dt;
+    }
+    if (desired > max_acceleration_) desired = max_acceleration_;
+    if (desired < -max_acceleration_) desired = -max_acceleration_;
+    acceleration_ = desired;
+    velocity_ += acceleration_ * dt;
+
+    // Snap to the target instead of overshooting it.
+    if ((error > 0.0 && velocity_ >= target_) || (error < 0.0 && velocity_ <= target_) ||
+        error == 0.0) {
+        if (max_jerk_ <= 0.0 || fabs(acceleration_) <= max_jerk_ * dt) {
+            velocity_ = target_;
+            acceleration_ = 0.0;
+        }
+    }
+    return velocity_;
+}
+
+bool VelocityProfile::is_settled(void) {
+    return velocity_ == target_ && acceleration_ == 0.0;
+}
+
+float VelocityProfile::get_velocity(void) { return velocity_; }
+
+float VelocityProfile::get_acceleration(void) { return acceleration_; }